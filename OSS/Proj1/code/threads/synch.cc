@@ -205,3 +205,108 @@ void Condition::Broadcast(Lock* conditionLock) {
 
     (void) interrupt->SetLevel(oldLevel);
  }
+
+//----------------------------------------------------------------------
+// WakeAll
+// 	Put every thread on "queue" on the ready list, in the order
+//	they went to sleep.  Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+static void
+WakeAll(List *queue)
+{
+    Thread *thread;
+
+    while ((thread = (Thread *)queue->Remove()) != NULL)
+	scheduler->ReadyToRun(thread);
+}
+
+//----------------------------------------------------------------------
+// Barrier::Barrier
+// 	Initialize a barrier for groups of "count" threads.
+//----------------------------------------------------------------------
+
+Barrier::Barrier(const char* debugName, int groupSize)
+{
+    ASSERT(groupSize > 0);
+    name = debugName;
+    count = groupSize;
+    arrived = 0;
+    queue = new List;
+}
+
+Barrier::~Barrier()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Wait
+// 	Wait for the rest of our group; the last thread to arrive wakes
+//	up the others and goes on without waiting.
+//----------------------------------------------------------------------
+
+void
+Barrier::Wait()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (++arrived < count) {
+	queue->Append((void *)currentThread);
+	currentThread->Sleep();
+    } else {
+	arrived = 0;			// ready for the next group
+	WakeAll(queue);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// CountDownLatch::CountDownLatch
+// 	Initialize a latch that opens after "count" calls to CountDown.
+//----------------------------------------------------------------------
+
+CountDownLatch::CountDownLatch(const char* debugName, int events)
+{
+    ASSERT(events >= 0);
+    name = debugName;
+    count = events;
+    queue = new List;
+}
+
+CountDownLatch::~CountDownLatch()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// CountDownLatch::CountDown
+// 	Count one event; the last one wakes up everyone waiting.
+//----------------------------------------------------------------------
+
+void
+CountDownLatch::CountDown()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (count > 0 && --count == 0)
+	WakeAll(queue);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// CountDownLatch::Wait
+// 	Wait until the count reaches zero.
+//----------------------------------------------------------------------
+
+void
+CountDownLatch::Wait()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (count > 0) {
+	queue->Append((void *)currentThread);
+	currentThread->Sleep();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
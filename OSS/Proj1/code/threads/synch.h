@@ -137,4 +137,54 @@ class Condition {
     List* queue;
     // plus some other stuff you'll need to define
 };
+
+// The following class defines a "barrier": a meeting point for a
+// group of "count" threads.  There is only one operation:
+//
+//	Wait() -- wait until all "count" threads have called Wait()
+//
+// The last thread to arrive wakes up the others, all at once, rather
+// than each of them calling Yield until a shared counter drops to
+// zero.  The barrier can then be used again by the next group.
+
+class Barrier {
+  public:
+    Barrier(const char* debugName, int count);	// group of "count"
+    ~Barrier();				// assumes no one is waiting
+    const char* getName() { return name; }
+
+    void Wait();
+
+  private:
+    const char* name;
+    int count;		// threads that make up a group
+    int arrived;	// threads of this group so far
+    List *queue;	// ... that are waiting for the rest
+};
+
+// The following class defines a "countdown latch", which opens for
+// good once "count" events have happened:
+//
+//	CountDown() -- one event has happened; the last one wakes up
+//		everyone waiting
+//
+//	Wait() -- wait until the count reaches zero
+//
+// Unlike with a Barrier, the threads that count down need not be the
+// ones that wait.
+
+class CountDownLatch {
+  public:
+    CountDownLatch(const char* debugName, int count);
+    ~CountDownLatch();			// assumes no one is waiting
+    const char* getName() { return name; }
+
+    void CountDown();
+    void Wait();
+
+  private:
+    const char* name;
+    int count;		// events still to happen
+    List *queue;	// threads waiting for them
+};
 #endif // SYNCH_H
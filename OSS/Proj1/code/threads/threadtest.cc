@@ -27,7 +27,7 @@ int testnum = 1;
 // Declare the shared variable
 int SharedVariable;
 
-int numThreadsActive; // used to implement barrier upon completion
+Barrier *allDone;	// every thread waits here once it is done
 
 
 #if defined(HW1_SEMAPHORES)
@@ -48,10 +48,7 @@ void SimpleThread(int which) {
 
         currentThread->Yield();  // Yield after incrementing and releasing semaphore
     }
-    numThreadsActive=numThreadsActive-1;
-    while (numThreadsActive != 0){
-       currentThread->Yield(); 
-    }
+    allDone->Wait();
     val = SharedVariable;
     printf("Thread %d sees final value %d\n", which, val);
 }
@@ -80,8 +77,8 @@ void
 ThreadTestNew(int n) {
     DEBUG('t', "Entering SimpleTest");
     Thread *t;
-    numThreadsActive = n;
-    printf("NumthreadsActive = %d\n", numThreadsActive);
+    allDone = new Barrier("all done", n);
+    printf("NumthreadsActive = %d\n", n);
 
     for(int i=1; i<n; i++)
     {
@@ -113,13 +110,8 @@ void SimpleThread(int which) {
         currentThread->Yield();  // Yield after incrementing and releasing the lock
     }
 
-    // Decrement numThreadsActive and wait for all threads to finish
-    numThreadsActive = numThreadsActive - 1;
-
-    // Yield while other threads are still active
-    while (numThreadsActive != 0) {
-        currentThread->Yield(); 
-    }
+    // Wait for all threads to finish
+    allDone->Wait();
 
     // Print final value of SharedVariable
     val = SharedVariable;
@@ -145,8 +137,8 @@ void
 ThreadTestNew(int n) {
     DEBUG('t', "Entering SimpleTest");
     Thread *t;
-    numThreadsActive = n;
-    printf("NumthreadsActive = %d\n", numThreadsActive);
+    allDone = new Barrier("all done", n);
+    printf("NumthreadsActive = %d\n", n);
 
     for(int i=1; i<n; i++)
     {
@@ -0,0 +1,468 @@
+/* pagesim.c
+ *
+ * This program replays a page reference trace, written by "nachos -tr",
+ * against several page replacement policies, and prints the miss ratio
+ * of each for a range of memory sizes (a miss-ratio curve):
+ *
+ *	FIFO	-- evict the page that was brought in first
+ *	Clock	-- FIFO, but skip (and clear) pages referenced since
+ *	LRU	-- evict the page referenced least recently
+ *	LFU	-- evict the page referenced least often since it came
+ *		   in, the least recently referenced of those on a tie
+ *	ARC	-- Megiddo and Modha's adaptive replacement cache
+ *	OPT	-- Belady's optimal policy: evict the page whose next
+ *		   reference is furthest in the future
+ *
+ * All processes share the frames, as they do in Nachos; -p restricts
+ * the trace to one process.  Every miss counts, including the first
+ * reference to each page.
+ *
+ * Usage: pagesim [-p pid] [-min frames] [-max frames] [-step frames] trace
+ *
+ * Copyright (c) 1992-1993 The Regents of the University of California.
+ * All rights reserved.  See copyright.h for copyright notice and limitation
+ * of liability and disclaimer of warranty provisions.
+ */
+
+#define MAIN
+#include "copyright.h"
+#undef MAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TraceMagic	"NTRC"	/* must match machine/machine.h */
+#define WriteFlag	(1 << 23)
+#define Pid(record)	((record) >> 24)
+
+#define NumPolicies	6
+char *policyNames[NumPolicies] = { "FIFO", "Clock", "LRU", "LFU", "ARC", "OPT" };
+
+unsigned int *refs;	/* the trace, one dense page id per reference */
+int numRefs;
+int numPages;		/* distinct pages in the trace */
+
+/* per page state, shared by the policies (reset before each run) */
+int *resident;		/* in memory? (for ARC: which list it is on) */
+int *stamp;		/* LRU/LFU: time of last reference */
+int *count;		/* LFU: references since it came in */
+int *nextUse;		/* OPT: index of the next reference to it */
+int *nextRef;		/* OPT: for each reference, the next one to that page */
+int *frames;		/* pages in memory, for the policies that scan */
+int *prev, *next;	/* list links, for LRU and ARC */
+
+void
+Fail(char *message)
+{
+    fprintf(stderr, "pagesim: %s\n", message);
+    exit(1);
+}
+
+int
+CompareKeys(const void *a, const void *b)
+{
+    unsigned int x = *(unsigned int *) a, y = *(unsigned int *) b;
+    return (x < y) ? -1 : (x > y);
+}
+
+/* Read the trace, keeping only process "pid" (or all, if -1), and
+ * renumber the (pid, vpn) pairs densely from 0.
+ */
+void
+ReadTrace(char *fileName, int pid, int *numWrites, int *numProcesses)
+{
+    FILE *f = fopen(fileName, "rb");
+    unsigned char word[4];
+    unsigned int *keys, *sorted;
+    int size = 1024, i, lo, hi, mid;
+    int seenPid[256];
+
+    if (f == NULL)
+	Fail("cannot open the trace");
+    if (fread(word, 1, 4, f) != 4 || memcmp(word, TraceMagic, 4) != 0)
+	Fail("not a trace written by nachos -tr");
+
+    keys = (unsigned int *) malloc(size * sizeof(unsigned int));
+    numRefs = *numWrites = *numProcesses = 0;
+    memset(seenPid, 0, sizeof(seenPid));
+    while (fread(word, 1, 4, f) == 4) {
+	unsigned int record = word[0] | (word[1] << 8) | (word[2] << 16)
+				| ((unsigned int) word[3] << 24);
+	if (pid != -1 && Pid(record) != pid)
+	    continue;
+	if (record & WriteFlag)
+	    (*numWrites)++;
+	if (!seenPid[Pid(record)]++)
+	    (*numProcesses)++;
+	record &= ~WriteFlag;
+	/* a read and a write of the same page can alternate */
+	if (numRefs > 0 && keys[numRefs - 1] == record)
+	    continue;
+	if (numRefs == size) {
+	    size *= 2;
+	    keys = (unsigned int *) realloc(keys, size * sizeof(unsigned int));
+	}
+	keys[numRefs++] = record;
+    }
+    fclose(f);
+    if (numRefs == 0)
+	Fail("no references in the trace");
+
+    sorted = (unsigned int *) malloc(numRefs * sizeof(unsigned int));
+    memcpy(sorted, keys, numRefs * sizeof(unsigned int));
+    qsort(sorted, numRefs, sizeof(unsigned int), CompareKeys);
+    for (numPages = 0, i = 0; i < numRefs; i++)
+	if (i == 0 || sorted[i] != sorted[numPages - 1])
+	    sorted[numPages++] = sorted[i];
+
+    refs = keys;		/* renumber in place */
+    for (i = 0; i < numRefs; i++) {
+	lo = 0;
+	hi = numPages - 1;
+	while (lo < hi) {
+	    mid = (lo + hi) / 2;
+	    if (sorted[mid] < keys[i])
+		lo = mid + 1;
+	    else
+		hi = mid;
+	}
+	refs[i] = lo;
+    }
+    free(sorted);
+}
+
+/* Doubly linked lists over page ids, for LRU and ARC.  Each list has
+ * its MRU end at "head" and its LRU end at "tail".
+ */
+typedef struct {
+    int head, tail, size;
+} List;
+
+void
+ListInit(List *l)
+{
+    l->head = l->tail = -1;
+    l->size = 0;
+}
+
+void
+ListRemove(List *l, int page)
+{
+    if (prev[page] != -1) next[prev[page]] = next[page];
+    else l->head = next[page];
+    if (next[page] != -1) prev[next[page]] = prev[page];
+    else l->tail = prev[page];
+    l->size--;
+}
+
+void
+ListPushFront(List *l, int page)
+{
+    prev[page] = -1;
+    next[page] = l->head;
+    if (l->head != -1) prev[l->head] = page;
+    else l->tail = page;
+    l->head = page;
+    l->size++;
+}
+
+int
+ListPopBack(List *l)
+{
+    int page = l->tail;
+    ListRemove(l, page);
+    return page;
+}
+
+int
+SimulateFIFO(int numFrames)
+{
+    int misses = 0, used = 0, hand = 0, i, page;
+
+    for (i = 0; i < numRefs; i++) {
+	page = refs[i];
+	if (resident[page])
+	    continue;
+	misses++;
+	if (used < numFrames)
+	    frames[used++] = page;
+	else {
+	    resident[frames[hand]] = 0;
+	    frames[hand] = page;
+	    hand = (hand + 1) % numFrames;
+	}
+	resident[page] = 1;
+    }
+    return misses;
+}
+
+int
+SimulateClock(int numFrames)
+{
+    int misses = 0, used = 0, hand = 0, i, page;
+
+    /* resident[page]: 0 = out, 1 = in, 2 = in and referenced */
+    for (i = 0; i < numRefs; i++) {
+	page = refs[i];
+	if (resident[page]) {
+	    resident[page] = 2;
+	    continue;
+	}
+	misses++;
+	if (used < numFrames)
+	    frames[used++] = page;
+	else {
+	    while (resident[frames[hand]] == 2) {
+		resident[frames[hand]] = 1;
+		hand = (hand + 1) % numFrames;
+	    }
+	    resident[frames[hand]] = 0;
+	    frames[hand] = page;
+	    hand = (hand + 1) % numFrames;
+	}
+	resident[page] = 1;
+    }
+    return misses;
+}
+
+int
+SimulateLRU(int numFrames)
+{
+    int misses = 0, i, page;
+    List lru;
+
+    ListInit(&lru);
+    for (i = 0; i < numRefs; i++) {
+	page = refs[i];
+	if (resident[page])
+	    ListRemove(&lru, page);
+	else {
+	    misses++;
+	    if (lru.size == numFrames)
+		resident[ListPopBack(&lru)] = 0;
+	    resident[page] = 1;
+	}
+	ListPushFront(&lru, page);
+    }
+    return misses;
+}
+
+int
+SimulateLFU(int numFrames)
+{
+    int misses = 0, used = 0, i, j, page, victim;
+
+    for (i = 0; i < numRefs; i++) {
+	page = refs[i];
+	stamp[page] = i;
+	if (resident[page]) {
+	    count[page]++;
+	    continue;
+	}
+	misses++;
+	if (used < numFrames)
+	    victim = used++;
+	else {
+	    for (victim = 0, j = 1; j < numFrames; j++)
+		if (count[frames[j]] < count[frames[victim]]
+			|| (count[frames[j]] == count[frames[victim]]
+			    && stamp[frames[j]] < stamp[frames[victim]]))
+		    victim = j;
+	    resident[frames[victim]] = 0;
+	}
+	frames[victim] = page;
+	resident[page] = 1;
+	count[page] = 1;
+    }
+    return misses;
+}
+
+/* ARC keeps two lists of pages in memory: T1, seen once recently, and
+ * T2, seen at least twice; and two "ghost" lists of pages recently
+ * evicted from each, B1 and B2.  A hit in a ghost list moves the
+ * target size p of T1 towards the list that would have kept the page.
+ */
+enum { NotInARC, InT1, InT2, InB1, InB2 };
+List t1, t2, b1, b2;
+
+void
+ARCMove(List *from, List *to, int page, int list)
+{
+    ListRemove(from, page);
+    ListPushFront(to, page);
+    resident[page] = list;
+}
+
+void
+ARCReplace(int inB2, int p)
+{
+    int page;
+
+    if (t1.size >= 1 && ((inB2 && t1.size == p) || t1.size > p)) {
+	page = t1.tail;
+	ARCMove(&t1, &b1, page, InB1);
+    } else {
+	page = t2.tail;
+	ARCMove(&t2, &b2, page, InB2);
+    }
+}
+
+int
+SimulateARC(int numFrames)
+{
+    int misses = 0, p = 0, i, page, delta;
+
+    ListInit(&t1);
+    ListInit(&t2);
+    ListInit(&b1);
+    ListInit(&b2);
+    for (i = 0; i < numRefs; i++) {
+	page = refs[i];
+	switch (resident[page]) {
+	  case InT1:
+	    ARCMove(&t1, &t2, page, InT2);
+	    break;
+	  case InT2:
+	    ARCMove(&t2, &t2, page, InT2);
+	    break;
+	  case InB1:
+	    misses++;
+	    delta = (b1.size >= b2.size) ? 1 : b2.size / b1.size;
+	    p = (p + delta < numFrames) ? p + delta : numFrames;
+	    ARCReplace(0, p);
+	    ARCMove(&b1, &t2, page, InT2);
+	    break;
+	  case InB2:
+	    misses++;
+	    delta = (b2.size >= b1.size) ? 1 : b1.size / b2.size;
+	    p = (p - delta > 0) ? p - delta : 0;
+	    ARCReplace(1, p);
+	    ARCMove(&b2, &t2, page, InT2);
+	    break;
+	  default:
+	    misses++;
+	    if (t1.size + b1.size == numFrames) {
+		if (t1.size < numFrames) {
+		    resident[ListPopBack(&b1)] = NotInARC;
+		    ARCReplace(0, p);
+		} else
+		    resident[ListPopBack(&t1)] = NotInARC;
+	    } else if (t1.size + t2.size + b1.size + b2.size >= numFrames) {
+		if (t1.size + t2.size + b1.size + b2.size == 2 * numFrames)
+		    resident[ListPopBack(&b2)] = NotInARC;
+		ARCReplace(0, p);
+	    }
+	    ListPushFront(&t1, page);
+	    resident[page] = InT1;
+	}
+    }
+    return misses;
+}
+
+int
+SimulateOPT(int numFrames)
+{
+    int misses = 0, used = 0, i, j, page, victim;
+
+    for (i = 0; i < numRefs; i++) {
+	page = refs[i];
+	nextUse[page] = nextRef[i];
+	if (resident[page])
+	    continue;
+	misses++;
+	if (used < numFrames)
+	    victim = used++;
+	else {
+	    for (victim = 0, j = 1; j < numFrames; j++)
+		if (nextUse[frames[j]] > nextUse[frames[victim]])
+		    victim = j;
+	    resident[frames[victim]] = 0;
+	}
+	frames[victim] = page;
+	resident[page] = 1;
+    }
+    return misses;
+}
+
+int
+Simulate(int policy, int numFrames)
+{
+    int i;
+
+    for (i = 0; i < numPages; i++)
+	resident[i] = count[i] = stamp[i] = 0;
+    switch (policy) {
+      case 0: return SimulateFIFO(numFrames);
+      case 1: return SimulateClock(numFrames);
+      case 2: return SimulateLRU(numFrames);
+      case 3: return SimulateLFU(numFrames);
+      case 4: return SimulateARC(numFrames);
+      default: return SimulateOPT(numFrames);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    int pid = -1, minFrames = 1, maxFrames = 0, step = 0;
+    int numWrites, numProcesses, numFrames, policy, i;
+    char *fileName = NULL;
+
+    for (i = 1; i < argc; i++) {
+	if (!strcmp(argv[i], "-p") && i + 1 < argc)
+	    pid = atoi(argv[++i]);
+	else if (!strcmp(argv[i], "-min") && i + 1 < argc)
+	    minFrames = atoi(argv[++i]);
+	else if (!strcmp(argv[i], "-max") && i + 1 < argc)
+	    maxFrames = atoi(argv[++i]);
+	else if (!strcmp(argv[i], "-step") && i + 1 < argc)
+	    step = atoi(argv[++i]);
+	else if (argv[i][0] != '-' && fileName == NULL)
+	    fileName = argv[i];
+	else
+	    Fail("usage: pagesim [-p pid] [-min frames] [-max frames] "
+		 "[-step frames] trace");
+    }
+    if (fileName == NULL)
+	Fail("usage: pagesim [-p pid] [-min frames] [-max frames] "
+	     "[-step frames] trace");
+
+    ReadTrace(fileName, pid, &numWrites, &numProcesses);
+    if (maxFrames <= 0 || maxFrames > numPages)
+	maxFrames = numPages;	/* past that, only cold misses are left */
+    if (minFrames < 1)
+	minFrames = 1;
+    if (step <= 0)
+	step = (maxFrames - minFrames) / 16 + 1;
+
+    resident = (int *) malloc(numPages * sizeof(int));
+    stamp = (int *) malloc(numPages * sizeof(int));
+    count = (int *) malloc(numPages * sizeof(int));
+    nextUse = (int *) malloc(numPages * sizeof(int));
+    prev = (int *) malloc(numPages * sizeof(int));
+    next = (int *) malloc(numPages * sizeof(int));
+    frames = (int *) malloc(numPages * sizeof(int));
+    nextRef = (int *) malloc(numRefs * sizeof(int));
+    for (i = 0; i < numPages; i++)
+	nextUse[i] = numRefs;	/* "never", until seen from the back */
+    for (i = numRefs - 1; i >= 0; i--) {
+	nextRef[i] = nextUse[refs[i]];
+	nextUse[refs[i]] = i;
+    }
+
+    printf("%d references (%d writes) to %d pages by %d process%s\n",
+	   numRefs, numWrites, numPages, numProcesses,
+	   numProcesses == 1 ? "" : "es");
+    printf("miss ratio (%%) by number of frames:\n%6s", "frames");
+    for (policy = 0; policy < NumPolicies; policy++)
+	printf("%8s", policyNames[policy]);
+    printf("\n");
+    for (numFrames = minFrames; numFrames <= maxFrames; numFrames += step) {
+	printf("%6d", numFrames);
+	for (policy = 0; policy < NumPolicies; policy++)
+	    printf("%8.2f", 100.0 * Simulate(policy, numFrames) / numRefs);
+	printf("\n");
+    }
+    return 0;
+}
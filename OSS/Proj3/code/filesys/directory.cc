@@ -24,6 +24,7 @@
 #include "utility.h"
 #include "filehdr.h"
 #include "directory.h"
+#include "objcache.h"
 
 //----------------------------------------------------------------------
 // Directory::Directory
@@ -37,7 +38,11 @@
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
+    // every call to the file system reads the directory in again,
+    // into a table of the same size each time
+    tableCache = ObjectCache::ForSize("Directory table",
+					size * sizeof(DirectoryEntry));
+    table = (DirectoryEntry *) tableCache->Alloc();
     tableSize = size;
     for (int i = 0; i < tableSize; i++)
 	table[i].inUse = FALSE;
@@ -50,7 +55,7 @@ Directory::Directory(int size)
 
 Directory::~Directory()
 { 
-    delete [] table;
+    tableCache->Free(table);
 } 
 
 //----------------------------------------------------------------------
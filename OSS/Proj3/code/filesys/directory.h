@@ -18,6 +18,7 @@
 #define DIRECTORY_H
 
 #include "openfile.h"
+#include "objcache.h"
 
 #define FileNameMaxLen 		9	// for simplicity, we assume 
 					// file names are <= 9 characters long
@@ -53,6 +54,7 @@ class Directory {
     Directory(int size); 		// Initialize an empty directory
 					// with space for "size" files
     ~Directory();			// De-allocate the directory
+    CACHED_OBJECTS(Directory)
 
     void FetchFrom(OpenFile *file);  	// Init directory contents from disk
     void WriteBack(OpenFile *file);	// Write modifications to 
@@ -75,6 +77,7 @@ class Directory {
     int tableSize;			// Number of directory entries
     DirectoryEntry *table;		// Table of pairs: 
 					// <file name, file header location> 
+    ObjectCache *tableCache;		// where "table" came from
 
     int FindIndex(const char *name);		// Find the index into the directory 
 					//  table corresponding to "name"
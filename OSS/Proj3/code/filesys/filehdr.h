@@ -16,6 +16,7 @@
 
 #include "disk.h"
 #include "bitmap.h"
+#include "objcache.h"
 
 #define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
 #define MaxFileSize 	(NumDirect * SectorSize)
@@ -37,6 +38,8 @@
 
 class FileHeader {
   public:
+    CACHED_OBJECTS(FileHeader)
+
     bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
 						//  including allocating space 
 						//  on disk for the file data
@@ -50,6 +50,7 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "synch.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -78,7 +79,8 @@
 //----------------------------------------------------------------------
 
 FileSystem::FileSystem(bool format)
-{ 
+{
+    directoryLock = new RWLock("FileSystem directory"); 
     DEBUG('f', "Initializing the file system.\n");
     if (format) {
         BitMap *freeMap = new BitMap(NumSectors);
@@ -164,8 +166,8 @@ FileSystem::FileSystem(bool format)
 //	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
+// 	Creating and removing files hold the directory lock exclusively,
+//	so they cannot interleave with each other or with a lookup.
 //
 //	"name" -- name of file to be created
 //	"initialSize" -- size of file to be created
@@ -181,6 +183,7 @@ FileSystem::Create(const char *name, int initialSize)
     bool success;
 
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    directoryLock->AcquireWrite();
 
     directory = new Directory(NumDirEntries);
     directory->FetchFrom(directoryFile);
@@ -211,6 +214,7 @@ FileSystem::Create(const char *name, int initialSize)
         delete freeMap;
     }
     delete directory;
+    directoryLock->ReleaseWrite();
     return success;
 }
 
@@ -232,10 +236,12 @@ FileSystem::Open(const char *name)
     int sector;
 
     DEBUG('f', "Opening file %s\n", name);
+    directoryLock->AcquireRead();	// any number can look names up
     directory->FetchFrom(directoryFile);
     sector = directory->Find(name); 
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
+    directoryLock->ReleaseRead();
     delete directory;
     return openFile;				// return NULL if not found
 }
@@ -263,9 +269,11 @@ FileSystem::Remove(const char *name)
     int sector;
     
     directory = new Directory(NumDirEntries);
+    directoryLock->AcquireWrite();
     directory->FetchFrom(directoryFile);
     sector = directory->Find(name);
     if (sector == -1) {
+       directoryLock->ReleaseWrite();
        delete directory;
        return FALSE;			 // file not found 
     }
@@ -281,6 +289,7 @@ FileSystem::Remove(const char *name)
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
     directory->WriteBack(directoryFile);        // flush to disk
+    directoryLock->ReleaseWrite();
     delete fileHdr;
     delete directory;
     delete freeMap;
@@ -297,8 +306,10 @@ FileSystem::List()
 {
     Directory *directory = new Directory(NumDirEntries);
 
+    directoryLock->AcquireRead();
     directory->FetchFrom(directoryFile);
     directory->List();
+    directoryLock->ReleaseRead();
     delete directory;
 }
 
@@ -65,6 +65,8 @@ class FileSystem {
 };
 
 #else // FILESYS
+class RWLock;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -90,6 +92,8 @@ class FileSystem {
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   RWLock* directoryLock;		// shared to look names up, exclusive
+					// to change the directory or bitmap
 };
 
 #endif // FILESYS
@@ -15,6 +15,7 @@
 #include "filehdr.h"
 #include "openfile.h"
 #include "system.h"
+#include "synch.h"
 #ifdef HOST_SPARC
 #include <strings.h>
 #endif
@@ -32,6 +33,7 @@ OpenFile::OpenFile(int sector)
     hdr = new FileHeader;
     hdr->FetchFrom(sector);
     seekPosition = 0;
+    lock = new RWLock("OpenFile");
 }
 
 //----------------------------------------------------------------------
@@ -42,6 +44,7 @@ OpenFile::OpenFile(int sector)
 OpenFile::~OpenFile()
 {
     delete hdr;
+    delete lock;
 }
 
 //----------------------------------------------------------------------
@@ -66,6 +69,10 @@ OpenFile::Seek(int position)
 //
 //	Implemented using the more primitive ReadAt/WriteAt.
 //
+//	Readers of the same open file do not wait for each other: a Read
+//	claims its part of the file, moving seekPosition past it, before
+//	anything can block, so the next Read starts where it leaves off.
+//
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
 //	"numBytes" -- the number of bytes to transfer
@@ -74,16 +81,26 @@ OpenFile::Seek(int position)
 int
 OpenFile::Read(const char *into, int numBytes)
 {
-   int result = ReadAt(into, numBytes, seekPosition);
-   seekPosition += result;
+   lock->AcquireRead();
+   int position = seekPosition;
+   int fileLength = hdr->FileLength();
+
+   if (numBytes > fileLength - position)
+	numBytes = fileLength - position;
+   if (numBytes > 0)
+	seekPosition += numBytes;
+   int result = ReadBytes(into, numBytes, position);
+   lock->ReleaseRead();
    return result;
 }
 
 int
 OpenFile::Write(const char *into, int numBytes)
 {
-   int result = WriteAt(into, numBytes, seekPosition);
+   lock->AcquireWrite();
+   int result = WriteBytes(into, numBytes, seekPosition);
    seekPosition += result;
+   lock->ReleaseWrite();
    return result;
 }
 
@@ -115,6 +132,24 @@ OpenFile::Write(const char *into, int numBytes)
 
 int
 OpenFile::ReadAt(const char *into, int numBytes, int position)
+{
+    lock->AcquireRead();
+    int result = ReadBytes(into, numBytes, position);
+    lock->ReleaseRead();
+    return result;
+}
+
+int
+OpenFile::WriteAt(const char *from, int numBytes, int position)
+{
+    lock->AcquireWrite();
+    int result = WriteBytes(from, numBytes, position);
+    lock->ReleaseWrite();
+    return result;
+}
+
+int
+OpenFile::ReadBytes(const char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
     int i, firstSector, lastSector, numSectors;
@@ -144,7 +179,7 @@ OpenFile::ReadAt(const char *into, int numBytes, int position)
 }
 
 int
-OpenFile::WriteAt(const char *from, int numBytes, int position)
+OpenFile::WriteBytes(const char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
     int i, firstSector, lastSector, numSectors;
@@ -169,9 +204,9 @@ OpenFile::WriteAt(const char *from, int numBytes, int position)
 
 // read in first and last sector, if they are to be partially modified
     if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
+        ReadBytes(buf, SectorSize, firstSector * SectorSize);	
     if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
+        ReadBytes(&buf[(lastSector - firstSector) * SectorSize], 
 				SectorSize, lastSector * SectorSize);	
 
 // copy in the bytes we want to change 
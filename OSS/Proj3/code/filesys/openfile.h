@@ -22,6 +22,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "objcache.h"
 
 #ifdef FILESYS_STUB			// Temporarily implement calls to 
 					// Nachos file system as calls to UNIX!
@@ -30,6 +31,7 @@ class OpenFile {
   public:
     OpenFile(int f) { file = f; currentOffset = 0; }	// open the file
     ~OpenFile() { Close(file); }			// close the file
+    CACHED_OBJECTS(OpenFile)
 
     int ReadAt(const char *into, int numBytes, int position) { 
     		Lseek(file, position, 0); 
@@ -60,12 +62,14 @@ class OpenFile {
 
 #else // FILESYS
 class FileHeader;
+class RWLock;
 
 class OpenFile {
   public:
     OpenFile(int sector);		// Open a file whose header is located
 					// at "sector" on the disk
     ~OpenFile();			// Close the file
+    CACHED_OBJECTS(OpenFile)
 
     void Seek(int position); 		// Set the position from which to 
 					// start reading/writing -- UNIX lseek
@@ -89,6 +93,12 @@ class OpenFile {
   private:
     FileHeader *hdr;			// Header for this file 
     int seekPosition;			// Current position within the file
+    RWLock *lock;			// shared to read, exclusive to write
+
+    int ReadBytes(const char *into, int numBytes, int position);
+    int WriteBytes(const char *from, int numBytes, int position);
+					// ReadAt and WriteAt, with the
+					// lock already held
 };
 
 #endif // FILESYS
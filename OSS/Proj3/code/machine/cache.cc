@@ -0,0 +1,114 @@
+// cache.cc
+//	Routines to simulate one level of a set associative cache.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "cache.h"
+
+//----------------------------------------------------------------------
+// Cache::Cache
+// 	Initialize an empty cache of "size" bytes, made of sets of "ways"
+//	lines of "lineBytes" bytes each.
+//----------------------------------------------------------------------
+
+Cache::Cache(const char *debugName, int size, int ways, int lineBytes)
+{
+    ASSERT(size > 0 && ways > 0 && lineBytes >= 4);
+    ASSERT(size % (ways * lineBytes) == 0);
+
+    name = debugName;
+    assoc = ways;
+    lineSize = lineBytes;
+    numSets = size / (assoc * lineSize);
+
+    tags = new unsigned int[numSets * assoc];
+    valid = new bool[numSets * assoc];
+    lastUse = new int[numSets * assoc];
+    for (int i = 0; i < numSets * assoc; i++) {
+	valid[i] = FALSE;
+	lastUse[i] = 0;
+    }
+    now = 0;
+    for (int i = 0; i <= MaxCachePids; i++)
+	hits[i] = misses[i] = 0;
+}
+
+Cache::~Cache()
+{
+    delete [] tags;
+    delete [] valid;
+    delete [] lastUse;
+}
+
+//----------------------------------------------------------------------
+// Cache::Access
+// 	Look up the line holding "physAddr".  On a miss, it replaces the
+//	least recently used line of its set.
+//
+//	Returns TRUE if the line was in the cache.
+//----------------------------------------------------------------------
+
+bool
+Cache::Access(unsigned int physAddr, int pid)
+{
+    unsigned int line = physAddr / lineSize;
+    int first = (line % numSets) * assoc;	// first line of the set
+    unsigned int tag = line / numSets;
+    int victim = first;
+
+    if (pid < 0 || pid >= MaxCachePids)
+	pid = MaxCachePids;
+    now++;
+    for (int i = first; i < first + assoc; i++) {
+	if (valid[i] && tags[i] == tag) {
+	    lastUse[i] = now;
+	    hits[pid]++;
+	    return TRUE;
+	}
+	// prefer an empty line, then the least recently used one
+	if (valid[victim] && (!valid[i] || lastUse[i] < lastUse[victim]))
+	    victim = i;
+    }
+
+    valid[victim] = TRUE;
+    tags[victim] = tag;
+    lastUse[victim] = now;
+    misses[pid]++;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Cache::Print
+// 	Print the hit rate of the cache, and of each process that used it.
+//----------------------------------------------------------------------
+
+void
+Cache::Print()
+{
+    int totalHits = 0, totalMisses = 0;
+
+    for (int i = 0; i <= MaxCachePids; i++) {
+	totalHits += hits[i];
+	totalMisses += misses[i];
+    }
+    printf("%s: %d bytes, %d-way, %d-byte lines: hits %d, misses %d",
+	name, numSets * assoc * lineSize, assoc, lineSize,
+	totalHits, totalMisses);
+    if (totalHits + totalMisses > 0)
+	printf(" (%.2f%% hits)", 100.0 * totalHits / (totalHits + totalMisses));
+    printf("\n");
+
+    for (int i = 0; i <= MaxCachePids; i++) {
+	if (hits[i] + misses[i] == 0)
+	    continue;
+	if (i == MaxCachePids)
+	    printf("    other processes");
+	else
+	    printf("    process [%d]", i);
+	printf(": hits %d, misses %d (%.2f%% hits)\n", hits[i], misses[i],
+	    100.0 * hits[i] / (hits[i] + misses[i]));
+    }
+}
@@ -0,0 +1,50 @@
+// cache.h
+//	Data structures to simulate a processor cache.
+//
+//	A Cache is one level of a set associative cache with LRU
+//	replacement.  It only keeps tags, not data: the simulated memory
+//	is always up to date, so all a cache tells us is whether an
+//	access would have hit.  The Machine feeds it the physical address
+//	of every instruction fetch and data access, and charges the
+//	configured miss penalties (see Machine::SetCaches).
+//
+//	Hits and misses are counted per process id, for the report at
+//	halt.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define MaxCachePids	16	// processes counted separately; the
+				// rest are counted together
+
+class Cache {
+  public:
+    Cache(const char *debugName, int size, int ways, int lineBytes);
+				// "size" bytes, in "ways"-way sets of
+				// "lineBytes"-byte lines
+    ~Cache();
+
+    bool Access(unsigned int physAddr, int pid);
+				// look up (and on a miss, load) the line
+				// holding "physAddr"; TRUE on a hit
+    void Print();		// hit rates, overall and per process
+
+  private:
+    const char *name;
+    int numSets, assoc, lineSize;
+    unsigned int *tags;		// numSets * assoc line tags
+    bool *valid;
+    int *lastUse;		// when each line was last touched, for LRU
+    int now;			// counts accesses
+
+    int hits[MaxCachePids + 1], misses[MaxCachePids + 1];
+};
+
+#endif // CACHE_H
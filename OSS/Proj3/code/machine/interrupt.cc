@@ -23,10 +23,15 @@
 #include "copyright.h"
 #include "interrupt.h"
 #include "system.h"
+#include "synch.h"
+#include "objcache.h"
+#include "boundedbuffer.h"
 
 // String definitions for debugging messages
 
 static const char *intLevelNames[] = { "off", "on"};
+#define NotDue	0x7fffffff	// "nextDue" when nothing is pending
+
 static const char *intTypeNames[] = { "timer", "disk", "console write", 
 			"console read", "network send", "network recv"};
 
@@ -48,6 +53,7 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
     arg = param;
     when = time;
     type = kind;
+    order = 0;
 }
 
 //----------------------------------------------------------------------
@@ -60,7 +66,11 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    pendingCapacity = 16;
+    pending = new PendingInterrupt*[pendingCapacity];
+    numPending = 0;
+    nextDue = NotDue;
+    numScheduled = 0;
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -73,9 +83,9 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-	delete (PendingInterrupt*)(pending->Remove());
-    delete pending;
+    while (numPending > 0)
+	delete PendingRemove();
+    delete [] pending;
 }
 
 //----------------------------------------------------------------------
@@ -150,8 +160,6 @@ Interrupt::Enable()
 void
 Interrupt::OneTick()
 {
-    MachineStatus old = status;
-
 // advance simulated time
     if (status == SystemMode) {
         stats->totalTicks += SystemTick;
@@ -163,6 +171,43 @@ Interrupt::OneTick()
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
 
 // check any pending interrupts are now ready to fire
+    FireDue();
+}
+
+//----------------------------------------------------------------------
+// Interrupt::Charge
+// 	Advance simulated time by "ticks", for a kernel routine that
+//	leaves interrupts enabled throughout, such as an uncontended
+//	Lock::Acquire.  Unlike OneTick, the pending interrupts are only
+//	looked at if one of them has come due, but then they fire just
+//	as if the routine had disabled and re-enabled interrupts.
+//----------------------------------------------------------------------
+void
+Interrupt::Charge(int ticks)
+{
+    ASSERT(level == IntOn);
+    if (status == SystemMode) {
+        stats->totalTicks += ticks;
+	stats->systemTicks += ticks;
+    } else {
+	stats->totalTicks += ticks;
+	stats->userTicks += ticks;
+    }
+    if (nextDue <= stats->totalTicks)
+	FireDue();
+}
+
+//----------------------------------------------------------------------
+// Interrupt::FireDue
+// 	Call the handlers of the pending interrupts that are due, and
+//	context switch afterwards if one of them asked for it.  Called
+//	with interrupts enabled.
+//----------------------------------------------------------------------
+void
+Interrupt::FireDue()
+{
+    MachineStatus old = status;
+
     ChangeLevel(IntOn, IntOff);		// first, turn off interrupts
 					// (interrupt handlers run with
 					// interrupts disabled)
@@ -242,6 +287,13 @@ Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
     stats->Print();
+    ObjectCache::PrintAll();
+    Thread::PrintStacks();
+    SynchProfile::PrintAll();
+    BufferStats::PrintAll();
+#ifdef USER_PROGRAM
+    machine->PrintCaches();
+#endif
     Cleanup();     // Never returns.
 }
 
@@ -250,7 +302,7 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: put it in a heap, ordered by when it is due.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -271,7 +323,8 @@ Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
 					intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    toOccur->order = numScheduled++;
+    PendingInsert(toOccur);
 }
 
 //----------------------------------------------------------------------
@@ -291,32 +344,29 @@ bool
 Interrupt::CheckIfDue(bool advanceClock)
 {
     MachineStatus old = status;
-    int when;
 
     ASSERT(level == IntOff);		// interrupts need to be disabled,
 					// to invoke an interrupt handler
+    if (nextDue > stats->totalTicks && !advanceClock)
+	return FALSE;			// the common case: not time yet
     if (DebugIsEnabled('i'))
 	DumpState();
-    PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
-
-    if (toOccur == NULL)		// no pending interrupts
+    if (numPending == 0)		// no pending interrupts
 	return FALSE;			
 
-    if (advanceClock && when > stats->totalTicks) {	// advance the clock
+    PendingInterrupt *toOccur = pending[0];
+    int when = toOccur->when;
+
+    if (when > stats->totalTicks) {	// advance the clock
 	stats->idleTicks += (when - stats->totalTicks);
 	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
-	return FALSE;
     }
 
 // Check if there is nothing more to do, and if so, quit
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
-				&& pending->IsEmpty()) {
-	 pending->SortedInsert(toOccur, when);
+				&& numPending == 1)
 	 return FALSE;
-    }
+    (void) PendingRemove();
 
     DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
@@ -342,10 +392,8 @@ Interrupt::CheckIfDue(bool advanceClock)
 //----------------------------------------------------------------------
 
 static void
-PrintPending(int arg)
+PrintPending(PendingInterrupt *pend)
 {
-    PendingInterrupt *pend = (PendingInterrupt *)arg;
-
     printf("Interrupt handler %s, scheduled at %d\n", 
 	intTypeNames[pend->type], pend->when);
 }
@@ -363,7 +411,115 @@ Interrupt::DumpState()
 					intLevelNames[level]);
     printf("Pending interrupts:\n");
     fflush(stdout);
-    pending->Mapcar(PrintPending);
+
+    // print them in the order they will fire: sort a copy of the heap
+    PendingInterrupt **sorted = new PendingInterrupt*[numPending];
+    for (int i = 0; i < numPending; i++) {
+	int j;
+	for (j = i; j > 0 && Before(pending[i], sorted[j - 1]); j--)
+	    sorted[j] = sorted[j - 1];
+	sorted[j] = pending[i];
+    }
+    for (int i = 0; i < numPending; i++)
+	PrintPending(sorted[i]);
+    delete [] sorted;
     printf("End of pending interrupts\n");
     fflush(stdout);
 }
+
+//----------------------------------------------------------------------
+// Interrupt::Before
+// 	Return TRUE if "a" is to fire before "b": it is due earlier, or
+//	at the same time but was scheduled first.
+//----------------------------------------------------------------------
+
+bool
+Interrupt::Before(PendingInterrupt *a, PendingInterrupt *b)
+{
+    if (a->when != b->when)
+	return a->when < b->when;
+    return a->order - b->order < 0;	// right even if "order" wrapped
+}
+
+//----------------------------------------------------------------------
+// Interrupt::PendingInsert, PendingRemove
+// 	Add an interrupt to the heap of pending interrupts, or take the
+//	next one due off of it, in O(log n).  Either way, update
+//	"nextDue", so that CheckIfDue can tell whether anything is due
+//	without looking at the heap.
+//----------------------------------------------------------------------
+
+void
+Interrupt::PendingInsert(PendingInterrupt *toOccur)
+{
+    if (numPending == pendingCapacity) {
+	PendingInterrupt **bigger = new PendingInterrupt*[pendingCapacity * 2];
+	for (int i = 0; i < numPending; i++)
+	    bigger[i] = pending[i];
+	delete [] pending;
+	pending = bigger;
+	pendingCapacity *= 2;
+    }
+    pending[numPending++] = toOccur;
+    SiftUp(numPending - 1);
+    nextDue = pending[0]->when;
+}
+
+PendingInterrupt *
+Interrupt::PendingRemove()
+{
+    PendingInterrupt *first = pending[0];
+
+    ASSERT(numPending > 0);
+    pending[0] = pending[--numPending];	// move the last one to the top
+    if (numPending > 0) {
+	SiftDown(0);
+	nextDue = pending[0]->when;
+    } else
+	nextDue = NotDue;
+    return first;
+}
+
+//----------------------------------------------------------------------
+// Interrupt::SiftUp, SiftDown
+// 	Restore the heap order, next interrupt due on top, after the
+//	interrupt at "i" was placed there.  The children of "i" are at
+//	PendingFanout * i + 1 on.
+//----------------------------------------------------------------------
+
+void
+Interrupt::SiftUp(int i)
+{
+    PendingInterrupt *toOccur = pending[i];
+
+    while (i > 0) {
+	int parent = (i - 1) / PendingFanout;
+
+	if (!Before(toOccur, pending[parent]))
+	    break;
+	pending[i] = pending[parent];
+	i = parent;
+    }
+    pending[i] = toOccur;
+}
+
+void
+Interrupt::SiftDown(int i)
+{
+    PendingInterrupt *toOccur = pending[i];
+
+    for (;;) {
+	int first = PendingFanout * i + 1;
+	int next = i;			// the child to fire first, if any
+					// fires before "toOccur"
+
+	for (int c = first; c < first + PendingFanout && c < numPending; c++)
+	    if (Before(pending[c], next == i ? toOccur : pending[next]))
+		next = c;
+	if (next == i)
+	    break;
+	pending[i] = pending[next];
+	i = next;
+    }
+    pending[i] = toOccur;
+}
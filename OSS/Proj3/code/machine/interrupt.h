@@ -36,7 +36,8 @@
 #define INTERRUPT_H
 
 #include "copyright.h"
-#include "list.h"
+#include "utility.h"
+#include "objcache.h"
 
 // Interrupts can be disabled (IntOff) or enabled (IntOn)
 enum IntStatus { IntOff, IntOn };
@@ -67,8 +68,17 @@ class PendingInterrupt {
     int arg;                    // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    int order;			// to fire interrupts due at the same
+				// time in the order they were scheduled
+
+    CACHED_OBJECTS(PendingInterrupt)	// one per device event
 };
 
+// Children of each node in the heap of pending interrupts.  A heap
+// wider than a binary one is shallower, so it takes fewer steps to put
+// an interrupt into it, which is what is done most.
+#define PendingFanout	4
+
 // The following class defines the data structures for the simulation
 // of hardware interrupts.  We record whether interrupts are enabled
 // or disabled, and any hardware interrupts that are scheduled to occur
@@ -96,6 +106,7 @@ class Interrupt {
 					// from an interrupt handler
 
     MachineStatus getStatus() { return status; } // idle, kernel, user
+    bool isInHandler() { return inHandler; } // in an interrupt handler?
     void setStatus(MachineStatus st) { status = st; }
 
     void DumpState();			// Print interrupt state
@@ -111,11 +122,20 @@ class Interrupt {
     					// by the hardware device simulators.
     
     void OneTick();       		// Advance simulated time
+    void Charge(int ticks);		// ... by "ticks", firing interrupts
+					// only if any are due
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    List *pending;		// the list of interrupts scheduled
-				// to occur in the future
+    PendingInterrupt **pending;	// the interrupts scheduled to occur
+				// in the future, as a heap with
+				// PendingFanout children per node,
+				// the next one due on top
+    int numPending;		// interrupts in the heap
+    int pendingCapacity;	// room in the heap
+    int nextDue;		// when the interrupt on top is due;
+				// a very large number if none
+    int numScheduled;		// ever; for PendingInterrupt::order
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
@@ -126,8 +146,19 @@ class Interrupt {
     bool CheckIfDue(bool advanceClock); // Check if an interrupt is supposed
 					// to occur now
 
+    void FireDue();			// Call the handlers of the interrupts
+					// that are due
+
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 	IntStatus now);  		// simulated time
+
+    // the heap of pending interrupts
+    bool Before(PendingInterrupt *a, PendingInterrupt *b);
+					// is "a" to fire before "b"?
+    void PendingInsert(PendingInterrupt *toOccur);
+    PendingInterrupt *PendingRemove();	// take the one on top off
+    void SiftUp(int i);
+    void SiftDown(int i);
 };
 
 #endif // INTERRRUPT_H
@@ -63,15 +63,22 @@ Machine::Machine(bool debug)
       	mainMemory[i] = 0;
 #ifdef USE_TLB
     tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
+    for (i = 0; i < TLBSize; i++) {
 	tlb[i].valid = FALSE;
+	tlb[i].asid = 0;
+    }
     pageTable = NULL;
+    asid = 0;
 #else	// use linear page table
     tlb = NULL;
     pageTable = NULL;
 #endif
 
     singleStep = debug;
+    traceFile = -1;
+    traceBuffer = NULL;
+    iCache = dCache = l2Cache = NULL;
+    l2Ticks = memoryTicks = 0;
     CheckEndian();
 }
 
@@ -82,6 +89,14 @@ Machine::Machine(bool debug)
 
 Machine::~Machine()
 {
+    if (traceFile != -1) {
+        FlushTrace();
+        Close(traceFile);
+        delete [] traceBuffer;
+    }
+    delete iCache;
+    delete dCache;
+    delete l2Cache;
     delete [] mainMemory;
     if (tlb != NULL)
         delete [] tlb;
@@ -24,6 +24,7 @@
 #include "copyright.h"
 #include "utility.h"
 #include "translate.h"
+#include "cache.h"
 #include "disk.h"
 
 // Definitions related to the size, and format of user memory
@@ -35,6 +36,9 @@
 #define NumPhysPages  128
 #define MemorySize 	(NumPhysPages * PageSize)
 #define TLBSize		4		// if there is a TLB, make it small
+#define NumAsids	64		// address space identifiers a TLB
+					// entry can be tagged with
+#define SuperPagePages	8		// pages in a superpage
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -126,11 +130,12 @@ class Machine {
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
     
-    bool ReadMem(int addr, int size, int* value);
+    bool ReadMem(int addr, int size, int* value, bool fetch = FALSE);
     bool WriteMem(int addr, int size, int value);
     				// Read or write 1, 2, or 4 bytes of virtual 
 				// memory (at addr).  Return FALSE if a 
 				// correct translation couldn't be found.
+				// "fetch" is TRUE for instruction fetches.
     
     ExceptionType Translate(int virtAddr, int* physAddr, int size,bool writing);
     				// Translate an address, and check for 
@@ -146,6 +151,17 @@ class Machine {
     void Debugger();		// invoke the user program debugger
     void DumpState();		// print the user CPU and memory state 
 
+    void StartTrace(const char *fileName);
+				// record every page referenced from now on
+				// in "fileName", for bin/pagesim
+
+    void SetCaches(Cache *instCache, Cache *dataCache, Cache *level2,
+		   int level2Ticks, int missTicks);
+				// simulate caches (any may be NULL), and
+				// charge these ticks for an L1 miss that
+				// hits in L2, or misses everywhere
+    void PrintCaches();		// report cache hit rates
+
 
 // Data structures -- all of these are accessible to Nachos kernel code.
 // "public" for convenience.
@@ -175,9 +191,15 @@ class Machine {
 // space, stored in memory), there is only one TLB (implemented in hardware).
 // Thus the TLB pointer should be considered as *read-only*, although 
 // the contents of the TLB are free to be modified by the kernel software.
+//
+// Each TLB entry is tagged with the address space identifier (ASID) of
+// the address space it belongs to, and only matches while "asid" holds
+// the same value.  So a context switch need only load "asid", and the
+// entries of other address spaces can stay in the TLB.
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int asid;				// ASID of the running address space
 
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
@@ -187,8 +209,33 @@ class Machine {
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
 				// time reaches this value
+
+    int traceFile;		// reference trace, or -1 if not tracing
+    unsigned int lastTraceRecord; // the record written last
+    char *traceBuffer;		// records not yet written out
+    int traceBytes;		// how much of traceBuffer is in use
+
+    void TraceReference(unsigned int vpn, bool writing);
+    void FlushTrace();
+
+    Cache *iCache, *dCache;	// level 1 instruction and data caches
+    Cache *l2Cache;		// unified level 2 cache
+    int l2Ticks, memoryTicks;	// miss penalties
+
+    void CacheAccess(int physAddr, bool fetch);
 };
 
+// A reference trace is the four bytes "NTRC", followed by one record
+// per reference: a little endian word holding the process id in the
+// top 8 bits, a write flag, and the virtual page number in the low
+// 23 bits.  A record that repeats the one before it is left out.
+
+#define TraceMagic		"NTRC"
+#define TraceBufferSize		4096	// bytes buffered between writes
+#define TraceRecord(pid, vpn, writing) \
+	(((unsigned) (pid) << 24) | ((writing) ? (1 << 23) : 0) \
+	 | ((vpn) & 0x7fffff))
+
 extern void ExceptionHandler(ExceptionType which);
 				// Entry point into Nachos for handling
 				// user system calls and exceptions
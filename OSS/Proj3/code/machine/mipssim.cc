@@ -99,7 +99,7 @@ Machine::OneInstruction(Instruction *instr)
 				// in the future
 
     // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
+    if (!machine->ReadMem(registers[PCReg], 4, &raw, TRUE))
 	return;			// exception occurred
     instr->value = raw;
     instr->Decode();
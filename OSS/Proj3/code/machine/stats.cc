@@ -21,7 +21,14 @@ Statistics::Statistics()
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
-    numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPageFaults = numPagesPrefetched = 0;
+    numPagesMerged = numPagesUnmerged = 0;
+    numSwapOuts = numSwapCompressed = 0;
+    numSwapRawBytes = numSwapCompressedBytes = 0;
+    numSwapHits = numSwapDiskReads = 0;
+    numTLBMisses = numTLBFlushes = 0;
+    numSuperPagesPromoted = numSuperPagesDemoted = 0;
+    numPacketsSent = numPacketsRecvd = 0;
 }
 
 //----------------------------------------------------------------------
@@ -38,7 +45,23 @@ Statistics::Print()
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
+    printf("Paging: faults %d, prefetched %d\n", numPageFaults,
+	numPagesPrefetched);
+    printf("Page merging: merged %d, copied on write %d\n", numPagesMerged,
+	numPagesUnmerged);
+    if (numSwapOuts > 0) {
+	int swapIns = numSwapHits + numSwapDiskReads;
+	printf("Swap: pages out %d, compressed %d (ratio %.2f), "
+	    "hit rate %.1f%%, disk reads saved %d\n", numSwapOuts,
+	    numSwapCompressed, numSwapCompressedBytes == 0 ? 0.0 :
+		(double) numSwapRawBytes / numSwapCompressedBytes,
+	    swapIns == 0 ? 0.0 : 100.0 * numSwapHits / swapIns, numSwapHits);
+    }
+    if (numTLBMisses > 0)
+	printf("TLB: misses %d, flushes %d\n", numTLBMisses, numTLBFlushes);
+    if (numSuperPagesPromoted > 0)
+	printf("Superpages: promoted %d, demoted %d\n", numSuperPagesPromoted,
+	    numSuperPagesDemoted);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
@@ -33,6 +33,19 @@ class Statistics {
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPagesPrefetched;	// pages brought in ahead of a fault
+    int numPagesMerged;		// pages mapped onto an identical frame
+    int numPagesUnmerged;	// shared pages copied on a write
+    int numSwapOuts;		// pages paged out
+    int numSwapCompressed;	// ... of which kept compressed in memory
+    int numSwapRawBytes;	// ... their size before compression
+    int numSwapCompressedBytes;	// ... and after
+    int numSwapHits;		// pages paged back in from memory
+    int numSwapDiskReads;	// pages paged back in from the swap file
+    int numTLBMisses;		// translations loaded into the TLB
+    int numTLBFlushes;		// times the ASIDs ran out
+    int numSuperPagesPromoted;	// page runs turned into superpages
+    int numSuperPagesDemoted;	// ... and split up again
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
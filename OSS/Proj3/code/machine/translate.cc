@@ -82,10 +82,11 @@ ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 //	"addr" -- the virtual address to read from
 //	"size" -- the number of bytes to read (1, 2, or 4)
 //	"value" -- the place to write the result
+//	"fetch" -- if TRUE, this is an instruction fetch (for the caches)
 //----------------------------------------------------------------------
 
 bool
-Machine::ReadMem(int addr, int size, int *value)
+Machine::ReadMem(int addr, int size, int *value, bool fetch)
 {
     int data;
     ExceptionType exception;
@@ -98,6 +99,7 @@ Machine::ReadMem(int addr, int size, int *value)
 	machine->RaiseException(exception, addr);
 	return FALSE;
     }
+    CacheAccess(physicalAddress, fetch);
     switch (size) {
       case 1:
 	data = machine->mainMemory[physicalAddress];
@@ -147,6 +149,7 @@ Machine::WriteMem(int addr, int size, int value)
 	machine->RaiseException(exception, addr);
 	return FALSE;
     }
+    CacheAccess(physicalAddress, FALSE);
     switch (size) {
       case 1:
 	machine->mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
@@ -221,7 +224,10 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	entry = &pageTable[vpn];
     } else {
         for (entry = NULL, i = 0; i < TLBSize; i++)
-    	    if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
+    	    if (tlb[i].valid && (tlb[i].asid == asid)
+			&& (tlb[i].superPage ?
+			    (vpn - tlb[i].virtualPage < SuperPagePages) :
+			    (tlb[i].virtualPage == vpn))) {
 		entry = &tlb[i];			// FOUND!
 		break;
 	    }
@@ -238,6 +244,8 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	return ReadOnlyException;
     }
     pageFrame = entry->physicalPage;
+    if (entry->superPage)		// the frames follow each other
+	pageFrame += vpn - entry->virtualPage;
 
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
@@ -248,8 +256,124 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     entry->use = TRUE;		// set the use, dirty bits
     if (writing)
 	entry->dirty = TRUE;
+    if (traceFile != -1)
+	TraceReference(vpn, writing);
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
     DEBUG('a', "phys addr = 0x%x\n", *physAddr);
     return NoException;
 }
+
+//----------------------------------------------------------------------
+// Machine::StartTrace
+// 	Write a record of every page that user programs reference from
+//	now on to the file "fileName".  bin/pagesim replays the trace
+//	against different page replacement policies.
+//----------------------------------------------------------------------
+
+void
+Machine::StartTrace(const char *fileName)
+{
+    traceFile = OpenForWrite(fileName);
+    WriteFile(traceFile, TraceMagic, 4);
+    traceBuffer = new char[TraceBufferSize];
+    traceBytes = 0;
+    lastTraceRecord = 0;		// no page 0 read by pid 0
+}
+
+//----------------------------------------------------------------------
+// Machine::TraceReference
+// 	Add a reference to virtual page "vpn" of the running process to
+//	the trace, unless it is the same as the reference before it:
+//	most instructions are fetched from the same page as the last one.
+//----------------------------------------------------------------------
+
+void
+Machine::TraceReference(unsigned int vpn, bool writing)
+{
+    int pid = (currentThread->space != NULL) ? currentThread->space->pcb->pid : 0;
+    unsigned int record = TraceRecord(pid, vpn, writing);
+
+    if (record == lastTraceRecord)
+	return;
+    lastTraceRecord = record;
+
+    for (int i = 0; i < 4; i++)		// little endian, whatever the host
+	traceBuffer[traceBytes++] = (char) (record >> (8 * i));
+    if (traceBytes == TraceBufferSize)
+	FlushTrace();
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTrace
+// 	Write out the records buffered so far.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTrace()
+{
+    WriteFile(traceFile, traceBuffer, traceBytes);
+    traceBytes = 0;
+}
+
+//----------------------------------------------------------------------
+// Machine::SetCaches
+// 	Start simulating a cache hierarchy: instruction fetches go to
+//	"instCache", other accesses to "dataCache", and misses in either
+//	to "level2".  A missing level is simply skipped.  An access that
+//	misses in level 1 costs "level2Ticks" more if it hits in level 2,
+//	and "missTicks" more if it has to go to memory.
+//----------------------------------------------------------------------
+
+void
+Machine::SetCaches(Cache *instCache, Cache *dataCache, Cache *level2,
+		   int level2Ticks, int missTicks)
+{
+    iCache = instCache;
+    dCache = dataCache;
+    l2Cache = level2;
+    l2Ticks = level2Ticks;
+    memoryTicks = missTicks;
+}
+
+//----------------------------------------------------------------------
+// Machine::CacheAccess
+// 	Run the access to "physAddr" through the caches, and charge the
+//	time a miss would take to the running program.
+//----------------------------------------------------------------------
+
+void
+Machine::CacheAccess(int physAddr, bool fetch)
+{
+    Cache *l1 = fetch ? iCache : dCache;
+    int pid, penalty;
+
+    if (l1 == NULL && l2Cache == NULL)
+	return;
+    pid = (currentThread->space != NULL) ? currentThread->space->pcb->pid : 0;
+
+    if (l1 != NULL && l1->Access(physAddr, pid))
+	return;
+    if (l2Cache != NULL && l2Cache->Access(physAddr, pid))
+	penalty = l2Ticks;
+    else
+	penalty = memoryTicks;
+    stats->totalTicks += penalty;
+    stats->userTicks += penalty;
+}
+
+//----------------------------------------------------------------------
+// Machine::PrintCaches
+// 	Print the hit rates of the simulated caches, if there are any.
+//----------------------------------------------------------------------
+
+void
+Machine::PrintCaches()
+{
+    if (iCache != NULL)
+	iCache->Print();
+    if (dCache != NULL)
+	dCache->Print();
+    if (l2Cache != NULL)
+	l2Cache->Print();
+}
@@ -26,6 +26,12 @@
 // virtual page to one physical page.
 // In addition, there are some extra bits for access control (valid and 
 // read-only) and some bits for usage information (use and dirty).
+//
+// An entry may also be part of a superpage: SuperPagePages virtual
+// pages, aligned on a multiple of SuperPagePages, held in as many
+// consecutive, equally aligned frames.  In a page table every page of
+// a superpage still has its own entry.  In the TLB, one entry, for
+// the first page, maps the whole superpage.
 
 class TranslationEntry {
   public:
@@ -40,6 +46,10 @@ class TranslationEntry {
 			// page is referenced or modified.
     bool dirty;         // This bit is set by the hardware every time the
 			// page is modified.
+    int asid;		// In the TLB, the address space this entry
+			// belongs to.  Unused in a page table.
+    bool superPage;	// If this bit is set, the entry is part of a
+			// superpage.
 };
 
 #endif
@@ -45,13 +45,13 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, const char *msgData)
 //      Initialize a single mail box within the post office, so that it
 //	can receive incoming messages.
 //
-//	Just initialize a list of messages, representing the mailbox.
+//	Just initialize a queue of messages, representing the mailbox.
 //----------------------------------------------------------------------
 
 
 MailBox::MailBox()
 { 
-    messages = new SynchList(); 
+    messages = new BoundedBuffer<Mail *>("mailbox", MailBoxSize); 
 }
 
 //----------------------------------------------------------------------
@@ -64,6 +64,8 @@ MailBox::MailBox()
 
 MailBox::~MailBox()
 { 
+    while (messages->Count() > 0)
+	delete messages->Get();
     delete messages; 
 }
 
@@ -86,10 +88,11 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 //----------------------------------------------------------------------
 // MailBox::Put
 // 	Add a message to the mailbox.  If anyone is waiting for message
-//	arrival, wake them up!
+//	arrival, wake them up!  If the mailbox is full, the message is
+//	dropped.
 //
 //	We need to reconstruct the Mail message (by concatenating the headers
-//	to the data), to simplify queueing the message on the SynchList.
+//	to the data), to simplify queueing the message in the mailbox.
 //
 //	"pktHdr" -- source, destination machine ID's
 //	"mailHdr" -- source, destination mailbox ID's
@@ -101,9 +104,12 @@ MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, const char *data)
 { 
     Mail *mail = new Mail(pktHdr, mailHdr, data); 
 
-    messages->Append((void *)mail);	// put on the end of the list of 
-					// arrived messages, and wake up 
+    if (!messages->TryPut(mail)) {	// put on the end of the queue of
+					// arrived messages, and wake up
 					// any waiters
+	DEBUG('n', "Mailbox %d full, dropping mail\n", mailHdr.to);
+	delete mail;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -122,8 +128,8 @@ void
 MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, const char *data) 
 { 
     DEBUG('n', "Waiting for mail in mailbox\n");
-    Mail *mail = (Mail *) messages->Remove();	// remove message from list;
-						// will wait if list is empty
+    Mail *mail = messages->Get();	// remove message from queue;
+					// will wait if queue is empty
 
     *pktHdr = mail->pktHdr;
     *mailHdr = mail->mailHdr;
@@ -29,7 +29,8 @@
 #define POST_H
 
 #include "network.h"
-#include "synchlist.h"
+#include "boundedbuffer.h"
+#include "objcache.h"
 
 // Mailbox address -- uniquely identifies a mailbox on a given machine.
 // A mailbox is just a place for temporary storage for messages.
@@ -68,12 +69,20 @@ class Mail {
      PacketHeader pktHdr;	// Header appended by Network
      MailHeader mailHdr;	// Header appended by PostOffice
      char data[MaxMailSize];	// Payload -- message data
+
+     CACHED_OBJECTS(Mail)
 };
 
 // The following class defines a single mailbox, or temporary storage
 // for messages.   Incoming messages are put by the PostOffice into the 
 // appropriate mailbox, and these messages can then be retrieved by
 // threads on this machine.
+//
+// A mailbox holds at most MailBoxSize messages.  Like a packet the
+// network drops, a message that arrives at a full mailbox is thrown
+// away, rather than holding up the delivery of mail to every other box.
+
+#define MailBoxSize	32
 
 class MailBox {
   public: 
@@ -87,7 +96,8 @@ class MailBox {
 				// mailbox (and wait if there is no message 
 				// to get!)
   private:
-    SynchList *messages;	// A mailbox is just a list of arrived messages
+    BoundedBuffer<Mail *> *messages; // A mailbox is just a queue of
+				// arrived messages
 };
 
 // The following class defines a "Post Office", or a collection of 
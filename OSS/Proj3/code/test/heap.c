@@ -0,0 +1,76 @@
+/* heap.c
+ *    Test program for Sbrk and malloc.
+ *
+ *    Like matmult, but the matrices are sized at run time and
+ *    allocated from the heap, so the binary does not reserve room for
+ *    the largest case.  Also checks that freed blocks are reused.
+ *    Exits with the last element of the product, (n-1)*(n-1)*n.
+ */
+
+#include "syscall.h"
+#include "malloc.h"
+
+int **
+NewMatrix(int n)
+{
+    int **m;
+    int i;
+
+    m = (int **) malloc(n * sizeof(int *));
+    if (m == 0) Exit(-1);
+    for (i = 0; i < n; i++) {
+        m[i] = (int *) malloc(n * sizeof(int));
+        if (m[i] == 0) Exit(-1);
+    }
+    return m;
+}
+
+void
+FreeMatrix(int **m, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        free(m[i]);
+    free(m);
+}
+
+int
+main()
+{
+    int **A, **B, **C;
+    int *p, *q;
+    int i, j, k, n;
+
+    /* freed blocks of a size class are handed out again */
+    p = (int *) malloc(100);
+    free(p);
+    q = (int *) malloc(100);
+    if (p != q) Exit(-2);
+    free(q);
+
+    for (n = 4; n <= 16; n *= 2) {
+        A = NewMatrix(n);
+        B = NewMatrix(n);
+        C = NewMatrix(n);
+
+        for (i = 0; i < n; i++)
+            for (j = 0; j < n; j++) {
+                A[i][j] = i;
+                B[i][j] = j;
+                C[i][j] = 0;
+            }
+
+        for (i = 0; i < n; i++)
+            for (j = 0; j < n; j++)
+                for (k = 0; k < n; k++)
+                    C[i][j] += A[i][k] * B[k][j];
+
+        k = C[n-1][n-1];
+        FreeMatrix(A, n);
+        FreeMatrix(B, n);
+        FreeMatrix(C, n);
+    }
+
+    Exit(k);
+}
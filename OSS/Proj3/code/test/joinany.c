@@ -0,0 +1,52 @@
+/* joinany.c
+ *    Test program for JoinAny.
+ *
+ *    Forks three children that spin for different lengths of time
+ *    and exit with different statuses, then reaps them with JoinAny
+ *    in whatever order they finish.  The parent sleeps while it waits,
+ *    so it prints nothing between the joins.  Exits with the sum of
+ *    the statuses, 6, and JoinAny should then return -1.
+ */
+
+#include "syscall.h"
+
+void
+Spin(int length, int status)
+{
+    int i, sum = 0;
+
+    for (i = 0; i < length; i++)
+        sum += i;
+    Exit(status);
+}
+
+void
+Short()
+{
+    Spin(100, 1);
+}
+
+void
+Medium()
+{
+    Spin(5000, 2);
+}
+
+void
+Long()
+{
+    Spin(20000, 3);
+}
+
+int
+main()
+{
+    int status, total = 0;
+
+    Fork(Long);
+    Fork(Short);
+    Fork(Medium);
+    while (JoinAny(&status) != -1)
+        total += status;
+    Exit(total);
+}
@@ -0,0 +1,123 @@
+/* malloc.c
+ *    A size-class allocator on top of Sbrk.
+ *
+ *    Small requests are rounded up to one of NumClasses power-of-two
+ *    sizes (16 .. 2048 bytes, header included), and each size has its
+ *    own free list, so malloc and free are a list pop and push.  An
+ *    empty list is refilled by carving a ChunkSize piece of new heap
+ *    into blocks of that size.  Anything bigger comes straight from
+ *    Sbrk and goes on a first-fit list of large blocks when freed.
+ *
+ *    Freed memory is never given back to the kernel.
+ */
+
+#include "syscall.h"
+#include "malloc.h"
+
+#define NumClasses	8
+#define MinBlockSize	16
+#define MaxBlockSize	2048	/* MinBlockSize << (NumClasses - 1) */
+#define ChunkSize	2048	/* heap grown at a time for small blocks */
+
+/* Every block starts with a header.  "size" is the whole block,
+ * header included; "next" is only used while the block is free.
+ */
+typedef struct Block {
+    int size;
+    struct Block *next;
+} Block;
+
+#define HeaderSize	((int) sizeof(Block))
+
+static Block *freeList[NumClasses];	/* free small blocks, by class */
+static Block *largeList;		/* free large blocks, first fit */
+
+/* Smallest class whose blocks hold "size" bytes plus the header,
+ * or -1 if the request is too big for any class.
+ */
+static int
+SizeClass(int size)
+{
+    int c, blockSize = MinBlockSize;
+
+    for (c = 0; c < NumClasses; c++) {
+        if (size + HeaderSize <= blockSize)
+            return c;
+        blockSize <<= 1;
+    }
+    return -1;
+}
+
+/* Carve a fresh piece of heap into blocks for class "c". */
+static int
+Refill(int c)
+{
+    int blockSize = MinBlockSize << c;
+    char *chunk = (char *) Sbrk(ChunkSize);
+    int offset;
+
+    if ((int) chunk == -1)
+        return 0;
+    for (offset = 0; offset + blockSize <= ChunkSize; offset += blockSize) {
+        Block *b = (Block *) (chunk + offset);
+        b->size = blockSize;
+        b->next = freeList[c];
+        freeList[c] = b;
+    }
+    return 1;
+}
+
+void *
+malloc(int size)
+{
+    Block *b, **prev;
+    int c;
+
+    if (size <= 0)
+        return 0;
+
+    c = SizeClass(size);
+    if (c >= 0) {
+        if (freeList[c] == 0 && !Refill(c))
+            return 0;
+        b = freeList[c];
+        freeList[c] = b->next;
+        return (void *) (b + 1);
+    }
+
+    /* large block: reuse a freed one if it fits, else grow the heap */
+    size = (size + HeaderSize + 7) & ~7;
+    for (prev = &largeList; *prev != 0; prev = &(*prev)->next) {
+        if ((*prev)->size >= size) {
+            b = *prev;
+            *prev = b->next;
+            return (void *) (b + 1);
+        }
+    }
+    b = (Block *) Sbrk(size);
+    if ((int) b == -1)
+        return 0;
+    b->size = size;
+    return (void *) (b + 1);
+}
+
+void
+free(void *ptr)
+{
+    Block *b;
+    int c;
+
+    if (ptr == 0)
+        return;
+
+    b = (Block *) ptr - 1;
+    if (b->size <= MaxBlockSize) {
+        for (c = 0; (MinBlockSize << c) != b->size; c++)
+            ;
+        b->next = freeList[c];
+        freeList[c] = b;
+    } else {
+        b->next = largeList;
+        largeList = b;
+    }
+}
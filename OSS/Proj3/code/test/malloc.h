@@ -0,0 +1,14 @@
+/* malloc.h
+ *    Dynamic memory for Nachos user programs.
+ *
+ *    The heap lives above the stack and is grown with the Sbrk system
+ *    call.  Link malloc.o after start.o into any program that uses it.
+ */
+
+#ifndef MALLOC_H
+#define MALLOC_H
+
+void *malloc(int size);		/* NULL (0) if the heap is exhausted */
+void free(void *ptr);		/* ptr must come from malloc, or be 0 */
+
+#endif /* MALLOC_H */
@@ -0,0 +1,35 @@
+/* mmap.c
+ *    Test program for memory-mapped files.
+ *
+ *    Maps in.dat, upper-cases it in place through the mapping, and
+ *    prints it.  Munmap writes the modified pages back to the file.
+ */
+
+#include "syscall.h"
+
+int
+main()
+{
+    OpenFileId src;
+    char *data;
+    int i, length;
+
+    src = Open("in.dat");
+    if (src < 0) Exit(100);
+
+    data = (char *) Mmap(src, 0);
+    if ((int) data == -1) Exit(200);
+    Close(src);			/* the mapping keeps the file open */
+
+    length = 0;
+    for (i = 0; data[i] != '\0' && data[i] != '\n'; i++) {
+        if (data[i] >= 'a' && data[i] <= 'z')
+            data[i] = data[i] - 'a' + 'A';
+        length++;
+    }
+
+    Write(data, length, ConsoleOutput);
+    Write("\n", 1, ConsoleOutput);
+
+    Exit(Munmap((int) data));
+}
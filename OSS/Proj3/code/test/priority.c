@@ -0,0 +1,54 @@
+/* priority.c
+ *    Test program for SetPriority.
+ *
+ *    Forks three children, which lower themselves to a low, a middle
+ *    and a high priority and then spin for a while.  The parent keeps
+ *    the highest priority until all three are forked, so none of them
+ *    runs early.  Whatever the order they were forked in, the children
+ *    should print "high", "middle" and "low", in that order.
+ */
+
+#include "syscall.h"
+
+void
+Spin(char *name, int length)
+{
+    int i, sum = 0;
+
+    for (i = 0; i < 10000; i++)
+        sum += i;
+    Write(name, length, ConsoleOutput);
+    Exit(sum);
+}
+
+void
+Low()
+{
+    SetPriority(10);
+    Spin("low\n", 4);
+}
+
+void
+Middle()
+{
+    SetPriority(20);
+    Spin("middle\n", 7);
+}
+
+void
+High()
+{
+    SetPriority(30);
+    Spin("high\n", 5);
+}
+
+int
+main()
+{
+    SetPriority(31);
+    Fork(Low);
+    Fork(Middle);
+    Fork(High);
+    SetPriority(0);		/* let the children run */
+    Exit(0);
+}
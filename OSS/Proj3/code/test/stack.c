@@ -0,0 +1,33 @@
+/* stack.c
+ *    Test program for stack growth.
+ *
+ *    Recurses far deeper than the initial stack allows, so the stack
+ *    has to grow a page at a time through guard-page faults.  Every
+ *    frame keeps a local array alive until the recursion unwinds, and
+ *    the sum checks that none of it was overwritten.
+ *    Exits with 1+2+...+DEPTH, 5050.
+ */
+
+#include "syscall.h"
+
+#define DEPTH	100
+
+int
+Recurse(int n)
+{
+    int local[8];
+    int i, sum;
+
+    for (i = 0; i < 8; i++)
+        local[i] = n;
+    sum = (n > 1) ? Recurse(n - 1) : 0;
+    for (i = 0; i < 8; i++)
+        if (local[i] != n) Exit(-1);
+    return sum + n;
+}
+
+int
+main()
+{
+    Exit(Recurse(DEPTH));
+}
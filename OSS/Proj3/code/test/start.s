@@ -74,6 +74,17 @@ Join:
 	j	$31
 	.end Join
 
+	/* Only return once some child of the caller has finished.
+ * Return its id, and its exit status in *status.
+ */
+	.globl JoinAny
+	.ent	JoinAny
+JoinAny:
+	addiu $2,$0,SC_JoinAny
+	syscall
+	j	$31
+	.end JoinAny
+
 	.globl Create
 	.ent	Create
 Create:
@@ -143,6 +154,38 @@ Kill:
 	/* Only return once the the process has been killed.
  */
 
+	.globl Mmap
+	.ent	Mmap
+Mmap:
+	addiu $2,$0,SC_Mmap
+	syscall
+	j	$31
+	.end Mmap
+
+	.globl Munmap
+	.ent	Munmap
+Munmap:
+	addiu $2,$0,SC_Munmap
+	syscall
+	j	$31
+	.end Munmap
+
+	.globl Sbrk
+	.ent	Sbrk
+Sbrk:
+	addiu $2,$0,SC_Sbrk
+	syscall
+	j	$31
+	.end Sbrk
+
+	.globl SetPriority
+	.ent	SetPriority
+SetPriority:
+	addiu $2,$0,SC_SetPriority
+	syscall
+	j	$31
+	.end SetPriority
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
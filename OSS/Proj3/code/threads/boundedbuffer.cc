@@ -0,0 +1,97 @@
+// boundedbuffer.cc
+//	Routines to keep the statistics of bounded buffers.
+//
+//	BoundedBuffer itself is a template, and so lives entirely in
+//	boundedbuffer.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "boundedbuffer.h"
+
+#include <string.h>
+
+BufferStats *BufferStats::all = NULL;
+
+//----------------------------------------------------------------------
+// BufferStats::Find
+// 	Return the statistics for buffers called "name", starting them
+//	if this is the first such buffer.  "capacity" is that of the
+//	first one; they are all assumed to be the same size.
+//----------------------------------------------------------------------
+
+BufferStats *
+BufferStats::Find(const char *name, int capacity)
+{
+    BufferStats *b;
+
+    for (b = all; b != NULL; b = b->next)
+	if (!strcmp(b->name, name))
+	    return b;
+    b = new BufferStats(name, capacity);
+    b->next = all;
+    all = b;
+    return b;
+}
+
+//----------------------------------------------------------------------
+// BufferStats::BufferStats
+// 	Start statistics for buffers called "debugName".  The name is
+//	copied: the buffer it came from may be gone by halt.
+//----------------------------------------------------------------------
+
+BufferStats::BufferStats(const char *debugName, int size)
+{
+    char *copy = new char[strlen(debugName) + 1];
+
+    strcpy(copy, debugName);
+    name = copy;
+    capacity = size;
+    put = got = putOps = occupancy = peak = 0;
+    putStalls = getStalls = drops = wakeups = 0;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// BufferStats::Added
+// 	Count "n" items put into a buffer, which now holds "count".
+//----------------------------------------------------------------------
+
+void
+BufferStats::Added(int n, int count)
+{
+    put += n;
+    putOps++;
+    occupancy += count;
+    if (count > peak)
+	peak = count;
+}
+
+//----------------------------------------------------------------------
+// BufferStats::PrintAll
+// 	Print, for each name of buffer that was used, how many items
+//	went through, how full the buffers got, and how often threads
+//	had to wait for them.
+//----------------------------------------------------------------------
+
+void
+BufferStats::PrintAll()
+{
+    bool any = FALSE;
+
+    for (BufferStats *b = all; b != NULL; b = b->next) {
+	if (b->putOps == 0 && b->drops == 0)
+	    continue;
+	if (!any)
+	    printf("Bounded buffers:\n");
+	any = TRUE;
+	printf("  %s (%d slots): %d in, %d out, peak %d, average %d.%d, "
+		"%d producer stalls, %d consumer stalls, %d dropped, "
+		"%d wakeups\n", b->name, b->capacity, b->put, b->got, b->peak,
+		b->occupancy / max(b->putOps, 1),
+		(b->occupancy * 10 / max(b->putOps, 1)) % 10,
+		b->putStalls, b->getStalls, b->drops, b->wakeups);
+    }
+}
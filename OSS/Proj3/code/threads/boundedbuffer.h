@@ -0,0 +1,302 @@
+// boundedbuffer.h
+//	Data structures for a bounded buffer: a queue of fixed capacity
+//	between threads that produce items and threads that consume them.
+//
+//	Unlike a SynchList, a BoundedBuffer allocates nothing per item --
+//	items are copied into a ring of a fixed number of slots -- and a
+//	producer that gets too far ahead waits for room, rather than using
+//	up the kernel's memory.  PutMany and GetMany move a whole batch of
+//	items per trip through the lock, and wake up the threads on the
+//	other side once per batch rather than once per item.
+//
+//	The buffer is told what an item is with a template argument:
+//
+//		BoundedBuffer<Mail *> *messages;
+//
+//	Buffers with the same name, such as every mailbox, share one set
+//	of statistics: how full they got, and how often producers and
+//	consumers had to wait.  They are printed at halt.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BOUNDEDBUFFER_H
+#define BOUNDEDBUFFER_H
+
+#include "copyright.h"
+#include "synch.h"
+
+// The following class keeps the statistics of the bounded buffers of
+// one name.
+
+class BufferStats {
+  public:
+    static BufferStats *Find(const char *name, int capacity);
+					// the statistics for buffers of
+					// this name, started if need be
+    static void PrintAll();		// those of every buffer used
+
+    void Added(int n, int count);	// "n" items put, "count" now in
+    void Removed(int n) { got += n; }	// "n" items taken out
+    void PutStalled() { putStalls++; }	// a producer waited for room
+    void GetStalled() { getStalls++; }	// a consumer waited for items
+    void Dropped() { drops++; }		// TryPut found no room
+    void Woke() { wakeups++; }		// woke up the other side
+
+  private:
+    BufferStats(const char *name, int capacity);
+
+    const char *name;
+    int capacity;			// of each buffer
+    int put;				// items put in
+    int got;				// items taken out
+    int putOps;				// batches put in
+    int occupancy;			// items in the buffer after each
+					// batch was put, in all
+    int peak;				// most items ever in a buffer
+    int putStalls;
+    int getStalls;
+    int drops;
+    int wakeups;
+    BufferStats *next;			// all of them, to print at halt
+
+    static BufferStats *all;
+};
+
+// The following class defines a bounded buffer of items of class T,
+// which must be cheap to copy (typically a pointer).  Items come out
+// in the order they went in.
+
+template <class T>
+class BoundedBuffer {
+  public:
+    BoundedBuffer(const char *debugName, int size);
+    ~BoundedBuffer();			// assumes no one is waiting;
+					// items still in it are dropped
+
+    void Put(T item);			// wait for room, then append "item"
+    bool TryPut(T item);		// ... FALSE rather than wait
+    T Get();				// wait for an item, then take the
+					// first one out
+    void PutMany(T *items, int n);	// Put all "n" items, as many at a
+					// time as there is room for
+    int GetMany(T *items, int max);	// wait for an item, then take out
+					// as many as there are, up to "max"
+
+    int Count() { return count; }	// items in the buffer right now
+
+  private:
+    void Append(T *items, int n);	// copy them in, with the lock held
+    void Take(T *items, int n);		// copy them out, with the lock held
+
+    const char *name;
+    T *ring;				// the items, from ring[first] on,
+    int capacity;			// wrapping around at the end
+    int first;
+    int count;
+    Lock *lock;				// protects all of the above
+    Condition *notEmpty;		// consumers wait here for items
+    Condition *notFull;			// producers wait here for room
+    int getWaiting;			// consumers waiting, so that we
+    int putWaiting;			// only wake up anyone if need be
+    BufferStats *usage;
+};
+
+//----------------------------------------------------------------------
+// BoundedBuffer::BoundedBuffer
+// 	Initialize an empty buffer with room for "size" items.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+template <class T>
+BoundedBuffer<T>::BoundedBuffer(const char *debugName, int size)
+{
+    ASSERT(size > 0);
+    name = debugName;
+    ring = new T[size];
+    capacity = size;
+    first = count = 0;
+    lock = new Lock(debugName);
+    notEmpty = new Condition(debugName);
+    notFull = new Condition(debugName);
+    getWaiting = putWaiting = 0;
+    usage = BufferStats::Find(debugName, capacity);
+}
+
+template <class T>
+BoundedBuffer<T>::~BoundedBuffer()
+{
+    delete [] ring;
+    delete lock;
+    delete notEmpty;
+    delete notFull;
+}
+
+//----------------------------------------------------------------------
+// BoundedBuffer::Append, BoundedBuffer::Take
+// 	Copy "n" items in at the end of the ring, or out from the front,
+//	and wake up one thread waiting on the other side if a single item
+//	moved, or all of them if a batch did.  Called with the lock held;
+//	the caller has checked that there is room, or that there are
+//	enough items.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+BoundedBuffer<T>::Append(T *items, int n)
+{
+    for (int i = 0; i < n; i++)
+	ring[(first + count + i) % capacity] = items[i];
+    count += n;
+    usage->Added(n, count);
+    if (getWaiting > 0) {
+	if (n == 1)
+	    notEmpty->Signal(lock);
+	else
+	    notEmpty->Broadcast(lock);
+	usage->Woke();
+    }
+}
+
+template <class T>
+void
+BoundedBuffer<T>::Take(T *items, int n)
+{
+    for (int i = 0; i < n; i++)
+	items[i] = ring[(first + i) % capacity];
+    first = (first + n) % capacity;
+    count -= n;
+    usage->Removed(n);
+    if (putWaiting > 0) {
+	if (n == 1)
+	    notFull->Signal(lock);
+	else
+	    notFull->Broadcast(lock);
+	usage->Woke();
+    }
+}
+
+//----------------------------------------------------------------------
+// BoundedBuffer::Put, BoundedBuffer::TryPut
+// 	Append "item" to the buffer, waiting for room if it is full, or
+//	returning FALSE instead of waiting.  TryPut is for a producer that
+//	must never block, such as one that serves many buffers; it is
+//	up to the producer what to do with the item.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+BoundedBuffer<T>::Put(T item)
+{
+    lock->Acquire();
+    while (count == capacity) {
+	usage->PutStalled();
+	putWaiting++;
+	notFull->Wait(lock);
+	putWaiting--;
+    }
+    Append(&item, 1);
+    lock->Release();
+}
+
+template <class T>
+bool
+BoundedBuffer<T>::TryPut(T item)
+{
+    bool room;
+
+    lock->Acquire();
+    room = (count < capacity);
+    if (room)
+	Append(&item, 1);
+    else
+	usage->Dropped();
+    lock->Release();
+    return room;
+}
+
+//----------------------------------------------------------------------
+// BoundedBuffer::Get
+// 	Take the first item out of the buffer, waiting for one if it is
+//	empty.
+//----------------------------------------------------------------------
+
+template <class T>
+T
+BoundedBuffer<T>::Get()
+{
+    T item;
+
+    lock->Acquire();
+    while (count == 0) {
+	usage->GetStalled();
+	getWaiting++;
+	notEmpty->Wait(lock);
+	getWaiting--;
+    }
+    Take(&item, 1);
+    lock->Release();
+    return item;
+}
+
+//----------------------------------------------------------------------
+// BoundedBuffer::PutMany
+// 	Append "n" items to the buffer.  As many go in at once as there
+//	is room for, waking up the consumers once for all of them;
+//	if there are more, we wait for room for the rest.
+//----------------------------------------------------------------------
+
+template <class T>
+void
+BoundedBuffer<T>::PutMany(T *items, int n)
+{
+    lock->Acquire();
+    while (n > 0) {
+	int batch;
+
+	while (count == capacity) {
+	    usage->PutStalled();
+	    putWaiting++;
+	    notFull->Wait(lock);
+	    putWaiting--;
+	}
+	batch = min(n, capacity - count);
+	Append(items, batch);
+	items += batch;
+	n -= batch;
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BoundedBuffer::GetMany
+// 	Wait until the buffer has something in it, then take out all
+//	that is there, up to "max" items, waking up the producers once
+//	for all of them.
+//
+//	Returns the number of items put in "items".
+//----------------------------------------------------------------------
+
+template <class T>
+int
+BoundedBuffer<T>::GetMany(T *items, int max)
+{
+    int n;
+
+    ASSERT(max > 0);
+    lock->Acquire();
+    while (count == 0) {
+	usage->GetStalled();
+	getWaiting++;
+	notEmpty->Wait(lock);
+	getWaiting--;
+    }
+    n = min(max, count);
+    Take(items, n);
+    lock->Release();
+    return n;
+}
+
+#endif // BOUNDEDBUFFER_H
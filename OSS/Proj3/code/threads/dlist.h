@@ -0,0 +1,253 @@
+// dlist.h
+//	Data structures to manage intrusive, doubly linked lists.
+//
+//	Unlike a List, a DList allocates nothing.  Each object that can be
+//	put on a list carries the link for it, a DListLink, as one of its
+//	members, so putting an object on a list or taking it off never
+//	calls new or delete, and an object can be taken off from the
+//	middle of its list in constant time.  The price is that an object
+//	can only be on one list per link it carries.
+//
+//	The list is told which member is the link with a pointer to member:
+//
+//		DList<Thread, &Thread::queueLink> readyList;
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef DLIST_H
+#define DLIST_H
+
+#include "copyright.h"
+#include "utility.h"
+
+// The link an object of class T needs to be on a DList.
+
+template <class T>
+class DListLink {
+  public:
+    DListLink() { prev = next = NULL; key = 0; list = NULL; }
+
+    T *prev;			// neighbours on the list, NULL at the ends
+    T *next;
+    int key;			// priority, for a sorted list
+    void *list;			// the list we are on, NULL if none
+};
+
+// The following class defines a list of objects of class T, linked
+// through their member "link".
+//
+// By using the "Sorted" functions, the list can be kept in sorted
+// in increasing order by key; items with the same key stay in the
+// order they were inserted.
+
+template <class T, DListLink<T> T::*link>
+class DList {
+  public:
+    DList() { first = last = NULL; }
+
+    bool IsEmpty() { return first == NULL; }
+    T *First() { return first; }		// NULL if the list is empty
+    T *Next(T *item) { return (item->*link).next; } // NULL at the end
+    bool Contains(T *item) { return (item->*link).list == this; }
+
+    void Append(T *item);	// Put item at the end of the list
+    void Prepend(T *item);	// Put item at the beginning of the list
+    T *Remove();		// Take item off the front of the list
+    int RemoveItem(T *item);	// Take "item" off; -1 if it is not here
+
+    void SortedInsert(T *item, int sortKey); // Put item into list
+    T *SortedRemove(int *keyPtr);	// Remove first item from list
+    T *SortedPeek(int *keyPtr);		// Look at it, leave it there
+    void SortedMerge(DList *other);	// Move all of "other" into list
+
+  private:
+    T *first;			// Head of the list, NULL if list is empty
+    T *last;			// Last element of list
+
+    void InsertAfter(T *prev, T *item); // prev NULL: at the front
+};
+
+//----------------------------------------------------------------------
+// DList::InsertAfter
+//	Link "item" in after "prev", or at the front if "prev" is NULL.
+//	"item" must not be on any list.
+//----------------------------------------------------------------------
+
+template <class T, DListLink<T> T::*link>
+void
+DList<T, link>::InsertAfter(T *prev, T *item)
+{
+    DListLink<T> *l = &(item->*link);
+
+    ASSERT(l->list == NULL);
+    l->list = this;
+    l->prev = prev;
+    l->next = (prev == NULL) ? first : (prev->*link).next;
+    if (l->next == NULL)
+	last = item;
+    else
+	(l->next->*link).prev = item;
+    if (prev == NULL)
+	first = item;
+    else
+	(prev->*link).next = item;
+}
+
+//----------------------------------------------------------------------
+// DList::Append, DList::Prepend
+//	Put "item" at the end, or at the front, of the list.
+//----------------------------------------------------------------------
+
+template <class T, DListLink<T> T::*link>
+void
+DList<T, link>::Append(T *item)
+{
+    (item->*link).key = 0;
+    InsertAfter(last, item);
+}
+
+template <class T, DListLink<T> T::*link>
+void
+DList<T, link>::Prepend(T *item)
+{
+    (item->*link).key = 0;
+    InsertAfter(NULL, item);
+}
+
+//----------------------------------------------------------------------
+// DList::Remove
+//	Take the first item off the list, and return it; NULL if the
+//	list is empty.
+//----------------------------------------------------------------------
+
+template <class T, DListLink<T> T::*link>
+T *
+DList<T, link>::Remove()
+{
+    T *item = first;
+
+    if (item != NULL)
+	RemoveItem(item);
+    return item;
+}
+
+//----------------------------------------------------------------------
+// DList::RemoveItem
+//	Take "item" off the list, wherever it is on it.
+//
+//	Returns 0, or -1 if "item" was not on this list.
+//----------------------------------------------------------------------
+
+template <class T, DListLink<T> T::*link>
+int
+DList<T, link>::RemoveItem(T *item)
+{
+    DListLink<T> *l = &(item->*link);
+
+    if (l->list != this)
+	return -1;
+    if (l->prev == NULL)
+	first = l->next;
+    else
+	(l->prev->*link).next = l->next;
+    if (l->next == NULL)
+	last = l->prev;
+    else
+	(l->next->*link).prev = l->prev;
+    l->prev = l->next = NULL;
+    l->list = NULL;
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// DList::SortedInsert
+//	Insert "item" so that the list stays sorted in increasing order
+//	by "sortKey", after any items with the same key.  Walks back from
+//	the end of the list, so that inserting items in order of their
+//	keys takes constant time.
+//----------------------------------------------------------------------
+
+template <class T, DListLink<T> T::*link>
+void
+DList<T, link>::SortedInsert(T *item, int sortKey)
+{
+    T *prev = last;
+
+    while (prev != NULL && sortKey < (prev->*link).key)
+	prev = (prev->*link).prev;
+    InsertAfter(prev, item);
+    (item->*link).key = sortKey;
+}
+
+//----------------------------------------------------------------------
+// DList::SortedRemove, DList::SortedPeek
+//	Remove, or just look at, the first item of a sorted list.
+//
+// Returns:
+//	Pointer to the item, NULL if nothing on the list.
+//	Sets *keyPtr to its key, if "keyPtr" is not NULL.
+//----------------------------------------------------------------------
+
+template <class T, DListLink<T> T::*link>
+T *
+DList<T, link>::SortedRemove(int *keyPtr)
+{
+    T *item = SortedPeek(keyPtr);
+
+    if (item != NULL)
+	RemoveItem(item);
+    return item;
+}
+
+template <class T, DListLink<T> T::*link>
+T *
+DList<T, link>::SortedPeek(int *keyPtr)
+{
+    if (first != NULL && keyPtr != NULL)
+	*keyPtr = (first->*link).key;
+    return first;
+}
+
+//----------------------------------------------------------------------
+// DList::SortedMerge
+//	Move every item of the sorted list "other" into this sorted list,
+//	leaving "other" empty.  Items with equal keys end up after the
+//	ones that were already here.  Takes one pass over both lists.
+//----------------------------------------------------------------------
+
+template <class T, DListLink<T> T::*link>
+void
+DList<T, link>::SortedMerge(DList *other)
+{
+    T *prev = NULL;			// the merged list so far ends here
+    T *mine = first;			// next item of each list to merge
+    T *theirs = other->first;
+
+    while (mine != NULL || theirs != NULL) {
+	T *item;
+
+	if (theirs == NULL || (mine != NULL
+			&& (mine->*link).key <= (theirs->*link).key)) {
+	    item = mine;
+	    mine = (mine->*link).next;
+	} else {
+	    item = theirs;
+	    theirs = (theirs->*link).next;
+	    (item->*link).list = this;
+	}
+	(item->*link).prev = prev;
+	if (prev == NULL)
+	    first = item;
+	else
+	    (prev->*link).next = item;
+	prev = item;
+    }
+    if (prev != NULL)
+	(prev->*link).next = NULL;
+    last = prev;
+    other->first = other->last = NULL;
+}
+
+#endif // DLIST_H
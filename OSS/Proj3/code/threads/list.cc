@@ -267,6 +267,25 @@ List::SortedInsert(void *item, int sortKey)
     }
 }
 
+//----------------------------------------------------------------------
+// List::SortedPeek
+//      Look at the first "item" of a sorted list, without removing it.
+//
+// Returns:
+//	Pointer to the first item, NULL if nothing on the list.
+//	Sets *keyPtr to its priority value, if there is one.
+//----------------------------------------------------------------------
+
+void *
+List::SortedPeek(int *keyPtr)
+{
+    if (IsEmpty())
+	return NULL;
+    if (keyPtr != NULL)
+        *keyPtr = first->key;
+    return first->item;
+}
+
 //----------------------------------------------------------------------
 // List::SortedRemove
 //      Remove the first "item" from the front of a sorted list.
@@ -15,6 +15,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "objcache.h"
 
 // The following class defines a "list element" -- which is
 // used to keep track of one item on a list.  It is equivalent to a
@@ -32,6 +33,8 @@ class ListElement {
 				// NULL if this is the last
      int key;		    	// priority, for a sorted list
      void *item; 	    	// pointer to item on the list
+
+     CACHED_OBJECTS(ListElement) // one per Append, freed by Remove
 };
 
 // The following class defines a "list" -- a singly linked list of
@@ -59,6 +62,7 @@ class List {
     // Routines to put/get items on/off list in order (sorted by key)
     void SortedInsert(void *item, int sortKey);	// Put item into list
     void *SortedRemove(int *keyPtr); 	  	// Remove first item from list
+    void *SortedPeek(int *keyPtr);		// Look at it, leave it there
 
   private:
     ListElement *first;  	// Head of the list, NULL if list is empty
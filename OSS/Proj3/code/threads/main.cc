@@ -9,7 +9,10 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-sp <scheduling policy> -sq <ticks> -lp -lt <ticks>
+//		-s -x <nachos file> -c <consoleIn> <consoleOut> -mt <ticks>
+//		-tr <trace file> -ci|-cd|-c2 <size> <assoc> <line size>
+//		-cpen <L2 hit ticks> <memory ticks>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
@@ -18,12 +21,29 @@
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -sp selects the scheduling policy: "priority" (the default),
+//	"mlfq", a multilevel feedback queue, or "fair", proportional
+//	share by priority (see scheduler.h)
+//    -sq sets the MLFQ time slice of the top level, in ticks; each
+//	level below gets twice as long (the default is TimerTicks)
+//    -lp profiles contention on semaphores, locks and condition
+//	variables, and prints the most contended at halt
+//    -lt sets the ticks charged for a P, V, Acquire or Release that
+//	need not wait or wake anyone up (the default is SystemTick); with
+//	0, they take no simulated time at all
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
 //    -c tests the console
+//    -mt gives up on creating a process after waiting this many ticks
+//	for free memory (the default is to wait for as long as it takes)
+//    -tr writes a trace of the pages user programs touch (see bin/pagesim)
+//    -ci, -cd and -c2 simulate an L1 instruction cache, an L1 data cache
+//	and an L2 cache; hit rates are printed at halt
+//    -cpen charges these extra ticks for an L1 miss that hits in the L2,
+//	and for one that misses there too
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
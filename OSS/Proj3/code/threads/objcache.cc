@@ -0,0 +1,156 @@
+// objcache.cc
+//	Routines to manage caches of objects of one size.
+//
+//	See objcache.h for how a class gets its objects from a cache.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "objcache.h"
+
+#include <string.h>
+
+// Every cache there is, in the order they were made.  A static
+// pointer is zero before any constructor runs, so caches that are
+// themselves static objects can link themselves in safely.
+
+ObjectCache *ObjectCache::allCaches = NULL;
+
+//----------------------------------------------------------------------
+// ObjectCache::ObjectCache
+// 	Initialize an empty cache of objects of "size" bytes.
+//
+//	The size is rounded up to a multiple of the strictest alignment
+//	a kernel object needs, and to at least a pointer, since a free
+//	object holds the link to the next one.
+//
+//	"debugName" is the name of the cache, for statistics.
+//	"size" is the size of each object, in bytes.
+//----------------------------------------------------------------------
+
+ObjectCache::ObjectCache(const char *debugName, int size)
+{
+    ASSERT(size > 0);
+    name = debugName;
+    if (size < (int) sizeof(void *))
+	size = sizeof(void *);
+    objectSize = divRoundUp(size, sizeof(double)) * sizeof(double);
+    slabObjects = SlabSize / objectSize;
+    if (slabObjects < MinSlabObjects)
+	slabObjects = MinSlabObjects;
+    freeList = NULL;
+    live = peak = allocs = slabs = 0;
+
+    // append, so that PrintAll reports caches in the order they were made
+    ObjectCache **prev = &allCaches;
+    while (*prev != NULL)
+	prev = &(*prev)->nextCache;
+    nextCache = NULL;
+    *prev = this;
+}
+
+//----------------------------------------------------------------------
+// ObjectCache::Grow
+// 	Get another slab from the heap, and put all of its objects on
+//	the free list.  The first object of the slab ends up first on
+//	the free list.
+//----------------------------------------------------------------------
+
+void
+ObjectCache::Grow()
+{
+    char *slab = new char[slabObjects * objectSize];
+
+    for (int i = slabObjects - 1; i >= 0; i--) {
+	void *object = slab + i * objectSize;
+
+	*(void **) object = freeList;
+	freeList = object;
+    }
+    slabs++;
+}
+
+//----------------------------------------------------------------------
+// ObjectCache::Alloc
+// 	Return an object from the cache, growing the cache if every
+//	object is in use.  The contents of the object are garbage.
+//----------------------------------------------------------------------
+
+void *
+ObjectCache::Alloc()
+{
+    void *object;
+
+    if (freeList == NULL)
+	Grow();
+    object = freeList;
+    freeList = *(void **) object;
+    allocs++;
+    if (++live > peak)
+	peak = live;
+    return object;
+}
+
+//----------------------------------------------------------------------
+// ObjectCache::Free
+// 	Return "object" to the cache it came from.  Freeing NULL does
+//	nothing, like delete.
+//----------------------------------------------------------------------
+
+void
+ObjectCache::Free(void *object)
+{
+    if (object == NULL)
+	return;
+    ASSERT(live > 0);
+    *(void **) object = freeList;
+    freeList = object;
+    live--;
+}
+
+//----------------------------------------------------------------------
+// ObjectCache::ForSize
+// 	Find the cache called "debugName" for objects of "size" bytes,
+//	making one the first time it is asked for.  This is for things
+//	such as arrays, that come in a few sizes each used over and over.
+//
+//	There are only ever a handful of caches, so a search is cheap,
+//	but callers that can should hold on to the cache they get.
+//----------------------------------------------------------------------
+
+ObjectCache *
+ObjectCache::ForSize(const char *debugName, int size)
+{
+    for (ObjectCache *c = allCaches; c != NULL; c = c->nextCache)
+	if (c->objectSize >= size && c->objectSize < size + (int) sizeof(double)
+			&& strcmp(c->name, debugName) == 0)
+	    return c;
+    return new ObjectCache(debugName, size);
+}
+
+//----------------------------------------------------------------------
+// ObjectCache::PrintAll
+// 	Print, for each cache that was used, how many objects are still
+//	live, the most ever live at once, how many were allocated in all,
+//	and how much memory the cache took from the heap.
+//----------------------------------------------------------------------
+
+void
+ObjectCache::PrintAll()
+{
+    bool any = FALSE;
+
+    for (ObjectCache *c = allCaches; c != NULL; c = c->nextCache) {
+	if (c->allocs == 0)
+	    continue;
+	if (!any)
+	    printf("Object caches:\n");
+	any = TRUE;
+	printf("  %s (%d bytes): live %d, peak %d, allocs %d, "
+		"%d slabs (%d bytes)\n", c->name, c->objectSize, c->live,
+		c->peak, c->allocs, c->slabs,
+		c->slabs * c->slabObjects * c->objectSize);
+    }
+}
@@ -0,0 +1,91 @@
+// objcache.h
+//	Data structures for a slab allocator: caches of objects of
+//	one size.
+//
+//	The kernel allocates and frees the same few kinds of objects
+//	over and over -- a ListElement for every Append, a
+//	PendingInterrupt for every device event, a Directory and a
+//	BitMap for every file system call.  Rather than go to the
+//	general purpose heap each time, each kind of object has a
+//	cache of its own.  A cache gets memory a slab at a time (room
+//	for many objects in one block), and keeps the objects freed
+//	back to it on a free list, so that allocating or freeing an
+//	object is normally a couple of pointer moves.
+//
+//	A class uses a cache by defining its own operator new and
+//	operator delete to call Alloc and Free; CACHED_OBJECTS below
+//	does that for it.
+//
+//	Slabs are never given back to the heap; a cache only grows to
+//	the peak number of objects of its kind that were ever live.
+//
+//	NOTE: no locking is done; as everywhere else in the kernel,
+//	we rely on a thread not being switched out in the middle of
+//	an Alloc or a Free, which never enable interrupts.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef OBJCACHE_H
+#define OBJCACHE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define SlabSize	4096	// bytes asked of the heap at a time
+#define MinSlabObjects	8	// ... but at least this many objects
+
+class ObjectCache {
+  public:
+    ObjectCache(const char *debugName, int size);
+				// a cache of objects of "size" bytes;
+				// allocates nothing until the first Alloc
+
+    void *Alloc();		// an object, taken off the free list
+    void Free(void *object);	// put "object" back on the free list
+    int Size() { return objectSize; }
+
+    static ObjectCache *ForSize(const char *debugName, int size);
+				// the cache "debugName" of objects of
+				// "size" bytes, made if there is none yet
+    static void PrintAll();	// print how each cache was used
+
+  private:
+    void Grow();		// carve a new slab into free objects
+
+    const char *name;		// for debugging and statistics
+    int objectSize;		// rounded up so any object is aligned
+    int slabObjects;		// objects per slab
+    void *freeList;		// free objects, linked through their
+				// first word
+    int live;			// objects handed out and not freed
+    int peak;			// most objects ever live at once
+    int allocs;			// calls to Alloc
+    int slabs;			// slabs taken from the heap
+
+    ObjectCache *nextCache;	// all caches, for ForSize and PrintAll
+    static ObjectCache *allCaches;
+};
+
+// Put among the public members of class "Class", to get its objects
+// from a cache of their own, called "Class":
+//
+//	class Thread {
+//	  public:
+//	    CACHED_OBJECTS(Thread)
+//
+// The cache is made the first time an object is allocated.
+
+#define CACHED_OBJECTS(Class)						\
+    void *operator new(size_t size) {					\
+	ASSERT(size == sizeof(Class));					\
+	return ObjCache()->Alloc();					\
+    }									\
+    void operator delete(void *object) { ObjCache()->Free(object); }	\
+    static ObjectCache *ObjCache() {					\
+	static ObjectCache cache(#Class, sizeof(Class));		\
+	return &cache;							\
+    }
+
+#endif // OBJCACHE_H
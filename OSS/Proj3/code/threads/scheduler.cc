@@ -11,8 +11,7 @@
 //	end up calling FindNextToRun(), and that would put us in an
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+// 	Strict priorities, FIFO among threads of the same priority.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -22,24 +21,65 @@
 #include "scheduler.h"
 #include "system.h"
 
+//----------------------------------------------------------------------
+// HighestBit
+// 	Return the number of the highest bit set in "mask", which must not
+//	be zero, with a fixed number of steps.
+//----------------------------------------------------------------------
+
+static int
+HighestBit(unsigned int mask)
+{
+    int bit = 0;
+
+    if (mask & 0xffff0000) { bit += 16; mask >>= 16; }
+    if (mask & 0xff00) { bit += 8; mask >>= 8; }
+    if (mask & 0xf0) { bit += 4; mask >>= 4; }
+    if (mask & 0xc) { bit += 2; mask >>= 2; }
+    if (mask & 0x2) bit += 1;
+    return bit;
+}
+
+// Under FairPolicy, the weight of each priority: 1.25 times that of
+// the priority below, 1024 at DefaultPriority.  A thread one priority
+// up gets about 25% more CPU time than one competing with it.
+static const int fairWeight[NumPriorities] = {
+    29, 36, 45, 56, 70, 88, 110, 137, 172, 215, 268, 336, 419, 524, 655, 819,
+    1024, 1280, 1600, 2000, 2500, 3125, 3906, 4883, 6104, 7629, 9537, 11921,
+    14901, 18626, 23283, 29104
+};
+
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
-// 	Initialize the list of ready but not running threads to empty.
+// 	Initialize the lists of ready but not running threads to empty.
 //----------------------------------------------------------------------
 
-Scheduler::Scheduler()
+Scheduler::Scheduler(SchedPolicy schedPolicy, int topQuantum)
 {
-    readyList = new List;
+    for (int p = 0; p < NumPriorities; p++)
+	readyList[p] = new ThreadList;
+    readyMask = 0;
+    policy = schedPolicy;
+    quantum = (topQuantum > 0) ? topQuantum : TimerTicks;
+    boostEpoch = lastBoost = 0;
+
+    heapCapacity = 16;
+    heap = new Thread*[heapCapacity];
+    heapSize = 0;
+    totalWeight = 0;
+    minVruntime = 0;
 }
 
 //----------------------------------------------------------------------
 // Scheduler::~Scheduler
-// 	De-allocate the list of ready threads.
+// 	De-allocate the lists of ready threads.
 //----------------------------------------------------------------------
 
 Scheduler::~Scheduler()
 {
-    delete readyList;
+    for (int p = 0; p < NumPriorities; p++)
+	delete readyList[p];
+    delete [] heap;
 }
 
 //----------------------------------------------------------------------
@@ -55,13 +95,47 @@ Scheduler::ReadyToRun (Thread *thread)
 {
     DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
 
+    if (policy == FairPolicy) {
+	if (thread == currentThread)
+	    Charge(thread);		// yielding: count this run first
+	else if (thread->getStatus() == JUST_CREATED)
+	    thread->vruntime = max(thread->vruntime, minVruntime);
+	else		// waking up: some, not all, credit for the sleep
+	    thread->vruntime = max(thread->vruntime,
+				   minVruntime - FairLatency / 2);
+	thread->setStatus(READY);
+	HeapInsert(thread);
+	return;
+    }
+    if (policy == MlfqPolicy && thread->levelEpoch != boostEpoch) {
+	thread->level = 0;		// slept through a reset
+	thread->levelEpoch = boostEpoch;
+	thread->sliceUsed = 0;
+    }
     thread->setStatus(READY);
-    readyList->Append((void *)thread);
+    readyList[QueueOf(thread)]->Append(thread);
+    readyMask |= 1 << QueueOf(thread);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QueueOf
+// 	Return the ready queue "thread" belongs on: the one for its
+//	priority, or, under MLFQ, the one for its level.
+//----------------------------------------------------------------------
+
+int
+Scheduler::QueueOf(Thread *thread)
+{
+    if (policy == MlfqPolicy)
+	return NumPriorities - 1 - thread->level;
+    return thread->getPriority();
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
-// 	Return the next thread to be scheduled onto the CPU.
+// 	Return the next thread to be scheduled onto the CPU: the first
+//	one of the highest priority, or, under FairPolicy, the one with
+//	the least virtual runtime.
 //	If there are no ready threads, return NULL.
 // Side effect:
 //	Thread is removed from the ready list.
@@ -70,7 +144,50 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    if (policy == FairPolicy) {
+	if (heapSize == 0)
+	    return NULL;
+	Thread *thread = heap[0];
+	HeapRemove(thread);
+	minVruntime = max(minVruntime, thread->vruntime);
+	return thread;
+    }
+
+    if (readyMask == 0)
+	return NULL;
+
+    int p = HighestBit(readyMask);
+    Thread *thread = readyList[p]->Remove();
+    if (readyList[p]->IsEmpty())
+	readyMask &= ~(1 << p);
+    return thread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Preempt
+// 	If a ready thread has a higher priority than the current one,
+//	switch to it: right away, or, in an interrupt handler, as soon
+//	as the handler returns.  Under FairPolicy, that is a thread that
+//	is behind the current one by more than FairMinSlice of virtual
+//	runtime.  Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Preempt ()
+{
+    if (currentThread->getStatus() != RUNNING)
+	return;
+    if (policy == FairPolicy) {
+	if (heapSize == 0
+		|| heap[0]->vruntime + FairMinSlice >= currentThread->vruntime)
+	    return;
+    } else if (readyMask == 0
+	    || HighestBit(readyMask) <= QueueOf(currentThread))
+	return;
+    if (interrupt->isInHandler())
+	interrupt->YieldOnReturn();
+    else
+	currentThread->Yield();
 }
 
 //----------------------------------------------------------------------
@@ -102,6 +219,10 @@ Scheduler::Run (Thread *nextThread)
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    if (oldThread->getStatus() != BLOCKED)  // Sleep charged it already,
+	Charge(oldThread);		    // before any time spent idle
+    nextThread->sliceStart = stats->totalTicks;
+
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
 
@@ -143,9 +264,230 @@ void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    for (int i = 0; i < heapSize; i++)
+	heap[i]->Print();
+    for (int p = NumPriorities - 1; p >= 0; p--)
+	for (Thread *thread = readyList[p]->First(); thread != NULL;
+		thread = readyList[p]->Next(thread))
+	    thread->Print();
 }
 
 int Scheduler::RemoveThread(Thread* thread) {
-    return readyList->RemoveItem(thread);
-}
\ No newline at end of file
+    if (policy == FairPolicy) {
+	if (thread->heapIndex < 0)
+	    return -1;
+	HeapRemove(thread);
+	return 0;
+    }
+    int p = QueueOf(thread);
+    int result = readyList[p]->RemoveItem(thread);
+    if (readyList[p]->IsEmpty())
+	readyMask &= ~(1 << p);
+    return result;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::QuantumExpired
+// 	Called on every timer interrupt.  Under the priority policy, the
+//	current thread always yields, so threads of the same priority
+//	take turns.  Under FairPolicy, it yields once it has had its
+//	share of FairLatency, if anyone else is ready.  Under MLFQ, it
+//	yields once it has used up the time slice of its level, and drops
+//	to the next level down.
+//
+//	This is also where MLFQ resets all levels, every MlfqBoostPeriod
+//	ticks, so that threads stuck at the bottom behind a stream of
+//	short jobs get to run.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::QuantumExpired()
+{
+    Thread *thread = currentThread;
+
+    if (policy == FairPolicy) {		// our share of FairLatency
+	int weight = fairWeight[thread->getPriority()];
+	int slice = FairLatency * weight / (totalWeight + weight);
+	return heapSize > 0 && stats->totalTicks - thread->sliceStart
+				    >= max(slice, FairMinSlice);
+    }
+    if (policy != MlfqPolicy)
+	return TRUE;
+
+    if (stats->totalTicks - lastBoost >= MlfqBoostPeriod)
+	Boost();
+    if (thread->levelEpoch != boostEpoch) {
+	thread->level = 0;
+	thread->levelEpoch = boostEpoch;
+	thread->sliceUsed = 0;
+    }
+
+    int used = thread->sliceUsed + stats->totalTicks - thread->sliceStart;
+    if (used < (quantum << thread->level))
+	return FALSE;
+
+    if (thread->level < MlfqLevels - 1) {
+	thread->level++;
+	DEBUG('t', "Thread \"%s\" used up its slice, now at level %d\n",
+	      thread->getName(), thread->level);
+    }
+    thread->sliceUsed = 0;
+    thread->sliceStart = stats->totalTicks;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::IOWait
+// 	The current thread is about to block waiting for a device, such
+//	as the disk or the console.  Under MLFQ, such a thread is likely
+//	interactive: it moves up a level, and starts a fresh time slice.
+//----------------------------------------------------------------------
+
+void
+Scheduler::IOWait()
+{
+    if (policy != MlfqPolicy)
+	return;
+    if (currentThread->level > 0)
+	currentThread->level--;
+    currentThread->sliceUsed = 0;
+    currentThread->sliceStart = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+// 	Start a new MLFQ epoch, in which every thread is back at the top
+//	level.  Ready threads move to the top queue now, in the order of
+//	their levels; running and blocked ones notice when they are next
+//	looked at.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Boost()
+{
+    int top = NumPriorities - 1;
+    Thread *thread;
+
+    DEBUG('t', "Resetting all threads to the top level\n");
+    boostEpoch++;
+    lastBoost = stats->totalTicks;
+    for (int p = top; p > top - MlfqLevels; p--) {
+	if (p != top)
+	    while ((thread = readyList[p]->Remove()) != NULL) {
+		thread->level = 0;
+		thread->levelEpoch = boostEpoch;
+		thread->sliceUsed = 0;
+		readyList[top]->Append(thread);
+	    }
+	readyMask &= ~(1 << p);
+    }
+    if (!readyList[top]->IsEmpty())
+	readyMask |= 1 << top;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Charge
+// 	Account for the time "thread" has been on the CPU since it last
+//	got it, or was last charged: its MLFQ time slice, and its virtual
+//	runtime, which grows more slowly the higher its priority.
+//
+//	A thread that blocks is charged as it goes to sleep (see
+//	Thread::Sleep), so neither the time it sleeps nor the time the CPU
+//	sits idle meanwhile counts; under FairPolicy, all it gets for
+//	sleeping is the credit ReadyToRun gives it when it wakes up.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Charge(Thread *thread)
+{
+    int ran = stats->totalTicks - thread->sliceStart;
+
+    thread->sliceStart = stats->totalTicks;
+    thread->sliceUsed += ran;
+    thread->vruntime += ran * fairWeight[DefaultPriority]
+				/ fairWeight[thread->getPriority()];
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HeapInsert, HeapRemove
+// 	Add "thread" to, or take it out of, the heap of ready threads,
+//	in O(log n).  Each thread knows its place in the heap, so it can
+//	be taken out from the middle too.
+//----------------------------------------------------------------------
+
+void
+Scheduler::HeapInsert(Thread *thread)
+{
+    if (heapSize == heapCapacity) {
+	Thread **bigger = new Thread*[heapCapacity * 2];
+	for (int i = 0; i < heapSize; i++)
+	    bigger[i] = heap[i];
+	delete [] heap;
+	heap = bigger;
+	heapCapacity *= 2;
+    }
+    heap[heapSize] = thread;
+    thread->heapIndex = heapSize++;
+    totalWeight += fairWeight[thread->getPriority()];
+    SiftUp(thread->heapIndex);
+}
+
+void
+Scheduler::HeapRemove(Thread *thread)
+{
+    int i = thread->heapIndex;
+
+    ASSERT(i >= 0 && i < heapSize && heap[i] == thread);
+    totalWeight -= fairWeight[thread->getPriority()];
+    thread->heapIndex = -1;
+    if (i == --heapSize)
+	return;
+    heap[i] = heap[heapSize];		// move the last one into the hole
+    heap[i]->heapIndex = i;
+    SiftDown(i);
+    SiftUp(i);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::HeapSwap, SiftUp, SiftDown
+// 	Restore the heap order, least virtual runtime on top, after the
+//	thread at "i" was placed there.
+//----------------------------------------------------------------------
+
+void
+Scheduler::HeapSwap(int i, int j)
+{
+    Thread *thread = heap[i];
+
+    heap[i] = heap[j];
+    heap[j] = thread;
+    heap[i]->heapIndex = i;
+    heap[j]->heapIndex = j;
+}
+
+void
+Scheduler::SiftUp(int i)
+{
+    while (i > 0 && heap[i]->vruntime < heap[(i - 1) / 2]->vruntime) {
+	HeapSwap(i, (i - 1) / 2);
+	i = (i - 1) / 2;
+    }
+}
+
+void
+Scheduler::SiftDown(int i)
+{
+    for (;;) {
+	int least = i;
+	int left = 2 * i + 1, right = 2 * i + 2;
+
+	if (left < heapSize && heap[left]->vruntime < heap[least]->vruntime)
+	    least = left;
+	if (right < heapSize && heap[right]->vruntime < heap[least]->vruntime)
+	    least = right;
+	if (least == i)
+	    return;
+	HeapSwap(i, least);
+	i = least;
+    }
+}
@@ -16,10 +16,43 @@
 // The following class defines the scheduler/dispatcher abstraction --
 // the data structures and operations needed to keep track of which
 // thread is running, and which threads are ready but not running.
+//
+// Ready threads are kept in one FIFO queue per priority.  A bitmap of
+// the non-empty queues finds the highest priority that has a thread
+// ready in constant time.
+//
+// The scheduling policy is chosen at startup:
+//
+//	PriorityPolicy -- strict priorities, set with Thread::setPriority;
+//		round robin within a priority, on every timer interrupt
+//	MlfqPolicy -- a multilevel feedback queue.  The top MlfqLevels
+//		queues are its levels; priorities are ignored.  A thread
+//		that uses up its time slice drops a level, where the slice
+//		is twice as long; one that blocks on a device moves up a
+//		level.  Every MlfqBoostPeriod ticks all threads go back to
+//		the top, so none starves.
+//	FairPolicy -- proportional share.  Each thread accumulates virtual
+//		runtime: CPU time divided by a weight that grows by 25% per
+//		priority level.  The ready thread with the least virtual
+//		runtime runs next, for a slice of FairLatency ticks shared
+//		out among the runnable threads by weight, but no shorter
+//		than FairMinSlice.  The ready threads are kept in a binary
+//		heap ordered by virtual runtime.
+
+enum SchedPolicy { PriorityPolicy, MlfqPolicy, FairPolicy };
+
+#define MlfqLevels	4
+#define MlfqBoostPeriod	10000
+
+#define FairLatency	(8 * TimerTicks)
+#define FairMinSlice	TimerTicks
 
 class Scheduler {
   public:
-    Scheduler();			// Initialize list of ready threads
+    Scheduler(SchedPolicy schedPolicy = PriorityPolicy, int topQuantum = 0);
+					// Initialize list of ready threads;
+					// "topQuantum" is the top level time
+					// slice, 0 for TimerTicks
     ~Scheduler();			// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	// Thread can be dispatched.
@@ -28,10 +61,39 @@ class Scheduler {
     void Run(Thread* nextThread);	// Cause nextThread to start running
     void Print();			// Print contents of ready list
     int RemoveThread(Thread* thread); // Remove thread from readyList
+    void Preempt();			// Let a more urgent ready thread
+					// have the CPU
+    bool QuantumExpired();		// on a timer interrupt: should the
+					// current thread give up the CPU?
+    void IOWait();			// the current thread is about to
+					// wait for a device
+    void Charge(Thread *thread);	// account for its time on the CPU
+    SchedPolicy getPolicy() { return policy; }
 
   private:
-    List *readyList;  		// queue of threads that are ready to run,
-				// but not running
+    ThreadList *readyList[NumPriorities]; // queues of threads that are ready
+				// to run, but not running, by priority
+    unsigned int readyMask;	// bit p set if readyList[p] is not empty
+
+    SchedPolicy policy;
+    int quantum;		// MLFQ time slice at the top level
+    int boostEpoch;		// number of MLFQ resets so far
+    int lastBoost;		// when the last one was
+
+    Thread **heap;		// FairPolicy: ready threads, least
+    int heapSize;		// virtual runtime first
+    int heapCapacity;
+    int totalWeight;		// of the threads in the heap
+    int minVruntime;		// never decreases; where new and waking
+				// threads are placed
+
+    int QueueOf(Thread *thread);	// which ready queue it belongs on
+    void Boost();			// move everyone to the top level
+    void HeapInsert(Thread *thread);
+    void HeapRemove(Thread *thread);
+    void HeapSwap(int i, int j);
+    void SiftUp(int i);
+    void SiftDown(int i);
 };
 
 #endif // SCHEDULER_H
@@ -25,6 +25,37 @@
 #include "synch.h"
 #include "system.h"
 
+#include <string.h>
+
+// Simulated time charged for P, V, Acquire or Release when it takes its
+// fast path; set with -lt.  The default is what disabling and
+// re-enabling interrupts costs.
+int synchFastTicks = SystemTick;
+
+//----------------------------------------------------------------------
+// FastPath
+// 	Charge the simulated time of a P, V, Acquire or Release that
+//	did not have to wait or wake anyone up.
+//
+//	Such an operation only tests and sets a field or two, so it
+//	leaves interrupts alone: it is still atomic, since on our
+//	uniprocessor the only things that can run in between are
+//	interrupt handlers, and they only run as simulated time
+//	advances.  So time is advanced, and any interrupts that have come
+//	due fire, only here, once the operation is done -- which is when
+//	re-enabling interrupts would have fired them.
+//
+//	If interrupts were already off, re-enabling them would not have
+//	been charged for either.
+//----------------------------------------------------------------------
+
+static void
+FastPath()
+{
+    if (synchFastTicks > 0 && interrupt->getLevel() == IntOn)
+	interrupt->Charge(synchFastTicks);
+}
+
 //----------------------------------------------------------------------
 // Semaphore::Semaphore
 // 	Initialize a semaphore, so that it can be used for synchronization.
@@ -37,7 +68,8 @@ Semaphore::Semaphore(const char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List;
+    queue = new ThreadList;
+    profile = SynchProfile::Find("semaphore", debugName);
 }
 
 //----------------------------------------------------------------------
@@ -64,12 +96,28 @@ Semaphore::~Semaphore()
 void
 Semaphore::P()
 {
+    if (value > 0) {				// fast path: no need to wait
+	if (profile != NULL)
+	    profile->Op();
+	value--;
+	FastPath();
+	return;
+    }
+
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+    int since = stats->totalTicks;
+    bool waited = (value == 0);
 
     while (value == 0) { 			// semaphore not available
-	queue->Append((void *)currentThread);	// so go to sleep
+	queue->SortedInsert(currentThread, // so go to sleep,
+		-currentThread->getPriority());	// most urgent first
 	currentThread->Sleep();
     }
+    if (profile != NULL) {
+	profile->Op();
+	if (waited)
+	    profile->Waited(since, NULL);
+    }
     value--; 					// semaphore available,
 						// consume its value
 
@@ -88,22 +136,35 @@ void
 Semaphore::V()
 {
     Thread *thread;
+
+    if (queue->IsEmpty()) {			// fast path: no one to wake up
+	if (profile != NULL)
+	    profile->Signalled();
+	value++;
+	FastPath();
+	return;
+    }
+
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    thread = (Thread *)queue->Remove();
+    if (profile != NULL)
+	profile->Signalled();
+    thread = queue->SortedRemove(NULL);
     if (thread != NULL)	   // make thread ready, consuming the V immediately
 	scheduler->ReadyToRun(thread);
     value++;
+    scheduler->Preempt();	// it may be more urgent than we are
     (void) interrupt->SetLevel(oldLevel);
 }
 
-// Dummy functions -- so we can compile our later assignments
-// Note -- without a correct implementation of Condition::Wait(),
-// the test case in the network assignment won't work!
 Lock::Lock(const char* debugName) {
     name = debugName;
     free = true;
-    queue = new List;
+    currentHolder = NULL;
+    nextHeld = NULL;
+    queue = new ThreadList;
+    profile = SynchProfile::Find("lock", debugName);
+    heldSince = 0;
 }
 Lock::~Lock() {
     delete queue;
@@ -114,33 +175,139 @@ bool Lock::isFree(){
 }
 
 
+// While we wait, the holder runs with our priority, if that is higher
+// than its own (priority inheritance).  Otherwise a thread of middle
+// priority could keep the holder, and so us, off the CPU indefinitely.
+// Release hands the lock to us directly, so once we wake up it is ours.
+// A free lock is taken without disabling interrupts (see FastPath).
 void Lock::Acquire() {
 
+    if (profile != NULL)
+        profile->Op();
+    if (free) {
+        free = false;
+        currentHolder = currentThread;
+        nextHeld = currentThread->heldLocks;
+        currentThread->heldLocks = this;
+        heldSince = stats->totalTicks;
+        FastPath();
+        return;
+    }
+
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int since = stats->totalTicks;
+    Thread* holder = currentHolder;
 
-    while (!free) {
-        queue->Append((void *) currentThread);
-        currentThread->Sleep();
-    }
-    free = false;
-    currentHolder = currentThread;
+    Enqueue(currentThread);
+    currentThread->Sleep();
+    ASSERT(isHeldByCurrentThread());
+    if (profile != NULL)
+        profile->Waited(since, holder);
 
     (void) interrupt->SetLevel(oldLevel);
 }
+
+// Let it run right away, if the waiter we handed the lock to now
+// outranks us.  With no one waiting, no one lent us any priority for
+// this lock and no one becomes ready, so there is nothing to do but
+// mark the lock free.
 void Lock::Release() {
 
     if (!isHeldByCurrentThread()) return;
+    if (queue->IsEmpty()) {
+        Unlink();
+        free = true;
+        currentHolder = NULL;
+        FastPath();
+        return;
+    }
+
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
-    
-    free = true;
-    currentHolder = NULL;
-    Thread* th = (Thread *)queue->Remove();
+
+    Unlock();
+    scheduler->Preempt();
+
+    (void) interrupt->SetLevel(oldLevel);
+
+}
+
+// Take ourselves off the holder's list of locks it holds.
+void Lock::Unlink() {
+
+    Lock **link = &currentThread->heldLocks;
+    while (*link != this)
+        link = &(*link)->nextHeld;
+    *link = nextHeld;
+    nextHeld = NULL;
+    if (profile != NULL)
+        profile->Held(heldSince);
+}
+
+// Hand back whatever priority our waiters lent us, and hand the lock
+// to the most urgent of them, if any: it becomes the holder before it
+// even runs, so no other thread can take the lock in between, and it
+// does not have to try again.  Called with interrupts disabled.
+void Lock::Unlock() {
+
+    Unlink();
+
+    Thread* th = queue->SortedRemove(NULL);
     if (th != NULL) {
+        th->waitingFor = NULL;
+        currentHolder = th;
+        heldSince = stats->totalTicks;
+        nextHeld = th->heldLocks;
+        th->heldLocks = this;
+        th->RecomputePriority();    // the rest of the waiters lend it theirs
         scheduler->ReadyToRun(th);
+    } else {
+        free = true;
+        currentHolder = NULL;
     }
+    currentThread->RecomputePriority();
+}
 
-    (void) interrupt->SetLevel(oldLevel);
+// Put "thread" among our waiters, and lend its priority to the holder.
+// Called with interrupts disabled, and the lock held.
+void Lock::Enqueue(Thread *thread) {
+    thread->waitingFor = this;
+    queue->SortedInsert(thread, -thread->getPriority());
+    currentHolder->Donate(thread->getPriority());
+}
 
+// The same for a whole queue of threads at once, in one pass over
+// the two queues.  "waiters" must be sorted the way our queue is, most
+// urgent first; it is left empty.
+void Lock::EnqueueAll(ThreadList *waiters) {
+    Thread *first = waiters->First();
+
+    if (first == NULL)
+        return;
+    for (Thread *th = first; th != NULL; th = waiters->Next(th))
+        th->waitingFor = this;
+    queue->SortedMerge(waiters);
+    currentHolder->Donate(first->getPriority());
+}
+
+int Lock::TopWaiterPriority() {
+    int key;
+
+    if (queue->SortedPeek(&key) == NULL)
+        return -1;
+    return -key;
+}
+
+void Lock::Requeue(Thread *thread) {
+    queue->RemoveItem(thread);
+    queue->SortedInsert(thread, -thread->getPriority());
+}
+
+// Take "thread" off our queue, without handing it the lock, and take
+// back whatever priority it lent our holder.  Called with interrupts
+// disabled.
+void Lock::Cancel(Thread *thread) {
+    queue->RemoveItem(thread);
+    currentHolder->RecomputePriority();
 }
 
 bool Lock::isHeldByCurrentThread() {
@@ -150,41 +317,428 @@ bool Lock::isHeldByCurrentThread() {
 
 Condition::Condition(const char* debugName) {
     name = debugName; // init
-    queue =  new List;
+    queue =  new ThreadList;
+    profile = SynchProfile::Find("condition", debugName);
 }
 Condition::~Condition() {
     delete queue;
 }
 
+// Going on the queue and releasing the lock happen with interrupts
+// off, so a Signal cannot slip in between.  We come back holding the
+// lock: Signal moved us to the lock's queue, and Release handed it to us.
 void Condition::Wait(Lock* conditionLock) {
 
     // check if calling thread holds the lock
     ASSERT(conditionLock->isHeldByCurrentThread());
-
-    // Release the lock
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int since = stats->totalTicks;
 
     // put self in the queue of waiting threads
+    queue->SortedInsert(currentThread, -currentThread->getPriority());
 
-    // Re-acquire the lock
+    // Release the lock; we are going to sleep anyway, so don't yield
+    // here to a thread we hand it to
+    conditionLock->Unlock();
+    currentThread->Sleep();
 
+    // Re-acquired the lock, by hand-off
+    ASSERT(conditionLock->isHeldByCurrentThread());
+    if (profile != NULL) {
+        profile->Op();
+        profile->Waited(since, NULL);
+    }
+    (void) interrupt->SetLevel(oldLevel);
 }
+
+// The thread we signal cannot run until we release the lock, so rather
+// than waking it now, move it to the lock's queue.
 void Condition::Signal(Lock* conditionLock) {
 
     // check if calling thread holds the lock
     ASSERT(conditionLock->isHeldByCurrentThread());
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (profile != NULL)
+        profile->Signalled();
 
-    // Dequeue one of the threads in the queue
+    // Dequeue the most urgent of the threads in the queue
+    Thread* th = queue->SortedRemove(NULL);
 
-    // If thread exists, wake it up.
+    // If thread exists, make it wait for the lock instead
+    if (th != NULL)
+        conditionLock->Enqueue(th);
 
+    (void) interrupt->SetLevel(oldLevel);
 }
+
+// Moves all our waiters to the lock's queue at once; they then get the
+// lock one at a time, as each releases it, rather than all waking up
+// to fight over it.
 void Condition::Broadcast(Lock* conditionLock) {
 
     // check if calling thread holds the lock
     ASSERT(conditionLock->isHeldByCurrentThread());
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-    // Dequeue all threads in the queue one-by-one
-
-    // Wakeup each thread
+    if (profile != NULL)
+        profile->Signalled();
+    conditionLock->EnqueueAll(queue);
 
+    (void) interrupt->SetLevel(oldLevel);
  }
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a reader-writer lock, held by no one.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"writerPreference" is whether waiting writers go ahead of readers
+//		that come along later.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(const char* debugName, bool writerPreference)
+{
+    name = debugName;
+    preferWriters = writerPreference;
+    lock = new Lock(debugName);
+    readersOk = new Condition(debugName);
+    writersOk = new Condition(debugName);
+    readers = waitingReaders = waitingWriters = 0;
+    writer = NULL;
+}
+
+RWLock::~RWLock()
+{
+    delete lock;
+    delete readersOk;
+    delete writersOk;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead, RWLock::ReleaseRead
+// 	Hold the lock in shared mode, and give it up.  The last reader
+//	out lets a waiting writer in.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireRead()
+{
+    lock->Acquire();
+    while (writer != NULL || (preferWriters && waitingWriters > 0)) {
+	waitingReaders++;
+	readersOk->Wait(lock);
+	waitingReaders--;
+    }
+    readers++;
+    lock->Release();
+}
+
+void
+RWLock::ReleaseRead()
+{
+    lock->Acquire();
+    ASSERT(readers > 0);
+    if (--readers == 0 && waitingWriters > 0)
+	writersOk->Signal(lock);
+    lock->Release();
+}
+
+bool
+RWLock::isWriteHeldByCurrentThread()
+{
+    return writer == currentThread;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite, RWLock::ReleaseWrite
+// 	Hold the lock in exclusive mode, and give it up.  A writer on
+//	its way out lets in either the next writer or all the waiting
+//	readers, whichever are preferred.
+//----------------------------------------------------------------------
+
+void
+RWLock::AcquireWrite()
+{
+    lock->Acquire();
+    ASSERT(writer != currentThread);
+    while (writer != NULL || readers > 0) {
+	waitingWriters++;
+	writersOk->Wait(lock);
+	waitingWriters--;
+    }
+    writer = currentThread;
+    lock->Release();
+}
+
+void
+RWLock::ReleaseWrite()
+{
+    lock->Acquire();
+    ASSERT(writer == currentThread);
+    writer = NULL;
+    if (waitingWriters > 0 && (preferWriters || waitingReaders == 0))
+	writersOk->Signal(lock);
+    else if (waitingReaders > 0)
+	readersOk->Broadcast(lock);	// they can all go at once
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// WakeAll
+// 	Make every thread on "queue" ready to run, in the order they
+//	went to sleep, and let the most urgent run if it outranks us.
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+static void
+WakeAll(ThreadList *queue)
+{
+    Thread *thread;
+
+    while ((thread = queue->Remove()) != NULL)
+	scheduler->ReadyToRun(thread);
+    scheduler->Preempt();
+}
+
+//----------------------------------------------------------------------
+// Barrier::Barrier
+// 	Initialize a barrier for groups of "count" threads.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+Barrier::Barrier(const char* debugName, int groupSize)
+{
+    ASSERT(groupSize > 0);
+    name = debugName;
+    count = groupSize;
+    arrived = 0;
+    queue = new ThreadList;
+    profile = SynchProfile::Find("barrier", debugName);
+}
+
+Barrier::~Barrier()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// Barrier::Wait
+// 	Wait for the rest of our group; the last thread to arrive wakes
+//	the others up and goes on without waiting.
+//----------------------------------------------------------------------
+
+void
+Barrier::Wait()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int since = stats->totalTicks;
+
+    if (profile != NULL)
+	profile->Op();
+    if (++arrived < count) {
+	queue->Append(currentThread);
+	currentThread->Sleep();
+	if (profile != NULL)
+	    profile->Waited(since, NULL);
+    } else {
+	arrived = 0;			// ready for the next group
+	if (profile != NULL)
+	    profile->Signalled();
+	WakeAll(queue);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// CountDownLatch::CountDownLatch
+// 	Initialize a latch that opens after "count" calls to CountDown;
+//	with a count of zero, it starts out open.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+CountDownLatch::CountDownLatch(const char* debugName, int events)
+{
+    ASSERT(events >= 0);
+    name = debugName;
+    count = events;
+    queue = new ThreadList;
+    profile = SynchProfile::Find("latch", debugName);
+}
+
+CountDownLatch::~CountDownLatch()
+{
+    delete queue;
+}
+
+//----------------------------------------------------------------------
+// CountDownLatch::CountDown
+// 	Count one event; the last one wakes up everyone waiting.
+//	Counting down an open latch does nothing.
+//----------------------------------------------------------------------
+
+void
+CountDownLatch::CountDown()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (count > 0 && --count == 0) {
+	if (profile != NULL)
+	    profile->Signalled();
+	WakeAll(queue);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// CountDownLatch::Wait
+// 	Wait until the latch is open.  Once it is, this returns right
+//	away, without disabling interrupts (see FastPath).
+//----------------------------------------------------------------------
+
+void
+CountDownLatch::Wait()
+{
+    if (profile != NULL)
+	profile->Op();
+    if (count == 0) {
+	FastPath();
+	return;
+    }
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int since = stats->totalTicks;
+
+    if (count > 0) {
+	queue->Append(currentThread);
+	currentThread->Sleep();
+	if (profile != NULL)
+	    profile->Waited(since, NULL);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+SynchProfile *SynchProfile::all = NULL;
+bool SynchProfile::enabled = FALSE;
+
+//----------------------------------------------------------------------
+// SynchProfile::Find
+// 	Return the statistics for synchronization objects of "kind"
+//	called "name", starting them if this is the first such object.
+//	Returns NULL if we are not profiling, so that the objects know
+//	to keep no statistics.
+//----------------------------------------------------------------------
+
+SynchProfile *
+SynchProfile::Find(const char *kind, const char *name)
+{
+    SynchProfile *p;
+
+    if (!enabled)
+	return NULL;
+    if (name == NULL)
+	name = "(unnamed)";
+    for (p = all; p != NULL; p = p->next)
+	if (p->kind == kind && !strcmp(p->name, name))
+	    return p;
+    p = new SynchProfile(kind, name);
+    p->next = all;
+    all = p;
+    return p;
+}
+
+//----------------------------------------------------------------------
+// SynchProfile::SynchProfile
+// 	Start statistics for objects of "kind" called "name".  The name
+//	is copied: the object it came from may be gone by halt.
+//----------------------------------------------------------------------
+
+SynchProfile::SynchProfile(const char *kindName, const char *debugName)
+{
+    kind = kindName;
+    name = new char[strlen(debugName) + 1];
+    strcpy(name, debugName);
+    ops = contended = waitTicks = maxWait = holdTicks = signals = 0;
+    maxWaiter = maxHolder = NULL;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchProfile::Waited, SynchProfile::Held
+// 	Count a wait by the current thread that started at "since",
+//	behind the lock holder "holder" (NULL if there is none), or the
+//	time a lock was held since "since".
+//----------------------------------------------------------------------
+
+void
+SynchProfile::Waited(int since, Thread *holder)
+{
+    int ticks = stats->totalTicks - since;
+
+    contended++;
+    waitTicks += ticks;
+    if (ticks >= maxWait) {
+	maxWait = ticks;
+	maxWaiter = currentThread->getName();
+	maxHolder = (holder != NULL) ? holder->getName() : NULL;
+    }
+}
+
+void
+SynchProfile::Held(int since)
+{
+    holdTicks += stats->totalTicks - since;
+}
+
+//----------------------------------------------------------------------
+// SynchProfile::PrintAll
+// 	Print the statistics of the SynchProfileTop objects that were
+//	waited for longest in all, most contended first.
+//----------------------------------------------------------------------
+
+void
+SynchProfile::PrintAll()
+{
+    SynchProfile *top[SynchProfileTop];
+    int numTop = 0;
+
+    if (!enabled)
+	return;
+    for (SynchProfile *p = all; p != NULL; p = p->next) {
+	int i;				// insert p into the sorted top list
+
+	if (p->ops == 0 && p->signals == 0)
+	    continue;
+	for (i = numTop; i > 0 && (top[i - 1]->waitTicks < p->waitTicks
+		    || (top[i - 1]->waitTicks == p->waitTicks
+			&& top[i - 1]->contended < p->contended)); i--)
+	    if (i < SynchProfileTop)
+		top[i] = top[i - 1];
+	if (i < SynchProfileTop) {
+	    top[i] = p;
+	    if (numTop < SynchProfileTop)
+		numTop++;
+	}
+    }
+
+    printf("Synchronization, most waited for first:\n");
+    for (int i = 0; i < numTop; i++) {
+	SynchProfile *p = top[i];
+
+	printf("  %s \"%s\": %d ops, %d contended, waited %d ticks",
+	       p->kind, p->name, p->ops, p->contended, p->waitTicks);
+	if (p->contended > 0) {
+	    printf(" (longest %d, by \"%s\"", p->maxWait, p->maxWaiter);
+	    if (p->maxHolder != NULL)
+		printf(" for \"%s\"", p->maxHolder);
+	    printf(")");
+	}
+	if (p->holdTicks > 0)
+	    printf(", held %d ticks", p->holdTicks);
+	if (p->signals > 0)
+	    printf(", %d signals", p->signals);
+	printf("\n");
+    }
+}
@@ -23,6 +23,53 @@
 
 class Thread;
 
+// P, V, Acquire and Release do not disable interrupts when they need
+// not wait or wake anyone up; they are charged this many ticks of
+// simulated time instead.  Set with -lt.
+
+extern int synchFastTicks;
+
+// The following class keeps contention statistics for the semaphores,
+// locks or condition variables of one name, when Nachos is run with
+// -lp (objects made before the flag is seen are not counted).  Objects
+// with the same name, such as the lock of every SynchDisk, share one
+// set of statistics.  At halt, the most contended ones are printed.
+
+#define SynchProfileTop	10	// how many to print
+
+class SynchProfile {
+  public:
+    static bool enabled;		// set by -lp
+    static SynchProfile *Find(const char *kind, const char *name);
+					// the statistics for objects of
+					// this kind and name; NULL when
+					// not profiling
+    static void PrintAll();		// the top SynchProfileTop
+
+    void Op() { ops++; }		// P, Acquire or Wait called
+    void Waited(int since, Thread *holder); // ... and it had to wait,
+					// from "since", behind "holder"
+    void Held(int since);		// a lock held since then released
+    void Signalled() { signals++; }	// V, Signal or Broadcast called
+
+  private:
+    SynchProfile(const char *kind, const char *name);
+
+    const char *kind;			// "semaphore", "lock", "barrier", ...
+    char *name;
+    int ops;				// calls to P, Acquire or Wait
+    int contended;			// ... that had to wait
+    int waitTicks;			// how long they waited, in all
+    int maxWait;			// the longest wait
+    const char *maxWaiter;		// the thread that waited longest
+    const char *maxHolder;		// the lock holder it waited for
+    int holdTicks;			// how long locks were held, in all
+    int signals;			// calls to V, Signal or Broadcast
+    SynchProfile *next;			// all of them, to print at halt
+
+    static SynchProfile *all;
+};
+
 // The following class defines a "semaphore" whose value is a non-negative
 // integer.  The semaphore has only two operations P() and V():
 //
@@ -50,7 +97,8 @@ class Semaphore {
   private:
     const char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
-    List *queue;       // threads waiting in P() for the value to be > 0
+    ThreadList *queue;       // threads waiting in P() for the value to be > 0
+    SynchProfile *profile;	// contention statistics, if any
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -80,14 +128,32 @@ class Lock {
 					// Condition variable ops below.
     
     bool isFree();
+
+    // for priority inheritance
+    Thread *getHolder() { return currentHolder; }
+    int TopWaiterPriority();		// priority of the most urgent
+					// waiter, -1 if there is none
+    void Requeue(Thread *thread);	// a waiter's priority changed
+    void Cancel(Thread *thread);	// a waiter is being killed
+    Lock *nextHeld;			// next lock held by our holder
     
   private:
     const char* name;				// for debugging
     // plus some other stuff you'll need to define
 
-    List *queue;       // threads waiting on lock to become free
+    ThreadList *queue;       // threads waiting on lock to become free, most
+		       // urgent first
     Thread* currentHolder;
     bool free; // keeps track of hte state of the lock
+    SynchProfile *profile;	// contention statistics, if any
+    int heldSince;		// when the holder got the lock
+
+    // for Condition, which moves its waiters straight to our queue
+    friend class Condition;
+    void Unlock();			// Release, without being preempted
+    void Unlink();			// off the holder's list of locks
+    void Enqueue(Thread *thread);	// "thread" now waits for us
+    void EnqueueAll(ThreadList *waiters); // and so do all of these
 };
 
 // The following class defines a "condition variable".  A condition
@@ -110,13 +176,16 @@ class Lock {
 //
 // In Nachos, condition variables are assumed to obey *Mesa*-style
 // semantics.  When a Signal or Broadcast wakes up another thread,
-// it simply puts the thread on the ready list, and it is the responsibility
-// of the woken thread to re-acquire the lock (this re-acquire is
-// taken care of within Wait()).  By contrast, some define condition
-// variables according to *Hoare*-style semantics -- where the signalling
-// thread gives up control over the lock and the CPU to the woken thread,
-// which runs immediately and gives back control over the lock to the
-// signaller when the woken thread leaves the critical section.
+// the thread must get the lock back before it returns from Wait().
+// Since the signaller holds that lock, a thread woken up only to block
+// again on the lock would be wasted effort; instead, Signal moves it
+// straight from the condition's queue to the lock's ("wait morphing"),
+// and Release hands it the lock when its turn comes.  By contrast,
+// some define condition variables according to *Hoare*-style semantics
+// -- where the signalling thread gives up control over the lock and the
+// CPU to the woken thread, which runs immediately and gives back
+// control over the lock to the signaller when the woken thread leaves
+// the critical section.
 //
 // The consequence of using Mesa-style semantics is that some other thread
 // can acquire the lock, and change data structures, before the woken
@@ -140,7 +209,107 @@ class Condition {
   private:
     const char* name;
     // plus some other stuff you'll need to define
-    List *queue;       // threads waiting on the condition variable
+    ThreadList *queue;       // threads waiting on the condition variable,
+			     // most urgent first
+    SynchProfile *profile;	// contention statistics, if any
+
+};
+
+// The following class defines a "reader-writer lock", for data that
+// is read much more often than it is changed.  Any number of threads
+// may hold it in shared mode, to read, as long as no thread holds it
+// in exclusive mode, to write:
+//
+//	AcquireRead, ReleaseRead -- hold the lock in shared mode
+//
+//	AcquireWrite, ReleaseWrite -- hold the lock in exclusive mode
+//
+// If writers are preferred, a reader that comes along while a writer
+// is waiting waits too, so that a stream of readers cannot keep the
+// writer out forever; otherwise, readers go ahead, and a writer waits
+// until there are none.  When a writer is done, the readers waiting
+// for it are all let in at once.
+//
+// It is built from a Lock and two Conditions, so a thread never
+// holds the inner lock while it reads or writes: that is only held
+// for the few instructions it takes to update the counts.
+
+class RWLock {
+  public:
+    RWLock(const char* debugName, bool writerPreference = TRUE);
+    ~RWLock();
+    const char* getName() { return name; }
+
+    void AcquireRead();
+    void ReleaseRead();
+    void AcquireWrite();
+    void ReleaseWrite();
 
+    bool isWriteHeldByCurrentThread();	// in exclusive mode
+
+  private:
+    const char* name;
+    bool preferWriters;		// see above
+    Lock *lock;			// protects the rest
+    Condition *readersOk;	// no writer in the way
+    Condition *writersOk;	// nobody holds the lock
+    int readers;		// threads holding the lock in shared mode
+    int waitingReaders;		// ... and waiting to
+    int waitingWriters;		// waiting for exclusive mode
+    Thread *writer;		// holding it in exclusive mode, if any
+};
+
+// The following class defines a "barrier": a meeting point for a
+// group of "count" threads.  There is only one operation:
+//
+//	Wait -- wait until all "count" threads have called Wait
+//
+// The last thread to arrive lets the others go, all at once, rather
+// than each of them polling a shared counter with Yield until it
+// drops to zero.  The barrier can then be used again, by the next
+// "count" threads.
+
+class Barrier {
+  public:
+    Barrier(const char* debugName, int count);
+    ~Barrier();				// assumes no one is waiting
+    const char* getName() { return name; }
+
+    void Wait();
+
+  private:
+    const char* name;
+    int count;			// threads that make up a group
+    int arrived;		// threads of this group so far
+    ThreadList *queue;		// ... that are waiting for the rest
+    SynchProfile *profile;	// contention statistics, if any
+};
+
+// The following class defines a "countdown latch": a gate that opens
+// for good once "count" events have happened.  The operations are:
+//
+//	CountDown -- one event has happened; if it was the last,
+//		let everyone waiting go, all at once
+//
+//	Wait -- wait until the count reaches zero
+//
+// Unlike a Barrier, the threads that count down need not be the ones
+// that wait, and need not wait themselves; a thread that starts some
+// workers can wait for all of them to finish.
+
+class CountDownLatch {
+  public:
+    CountDownLatch(const char* debugName, int count);
+    ~CountDownLatch();			// assumes no one is waiting
+    const char* getName() { return name; }
+
+    void CountDown();
+    void Wait();
+
+  private:
+    const char* name;
+    int count;			// events still to happen
+    ThreadList *queue;		// threads waiting for them
+    SynchProfile *profile;	// contention statistics, if any
 };
 #endif // SYNCH_H
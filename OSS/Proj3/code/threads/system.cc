@@ -7,6 +7,7 @@
 
 #include "copyright.h"
 #include "system.h"
+#include "synch.h"
 
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
@@ -33,6 +34,8 @@ Machine *machine;	// user program memory and registers
 MemoryManager* mm;
 Lock* mmLock;
 PCBManager* pcbManager;
+PageMerger* pageMerger;
+SwapCache* swapCache;
 #endif
 
 #ifdef NETWORK
@@ -58,13 +61,15 @@ extern void Cleanup();
 //	if the interrupted thread called Yield at the point it is
 //	was interrupted.
 //
+//	The scheduler decides whether the thread's time slice is up.
+//
 //	"dummy" is because every interrupt handler takes one argument,
 //		whether it needs it or not.
 //----------------------------------------------------------------------
 static void
 TimerInterruptHandler(int dummy)
 {
-    if (interrupt->getStatus() != IdleMode)
+    if (interrupt->getStatus() != IdleMode && scheduler->QuantumExpired())
 	interrupt->YieldOnReturn();
 }
 
@@ -84,9 +89,15 @@ Initialize(int argc, char **argv)
     int argCount;
     const char* debugArgs = "";
     bool randomYield = FALSE;
+    SchedPolicy policy = PriorityPolicy;
+    int quantum = 0;			// MLFQ top level slice, in ticks
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    int admissionTimeout = 0;	// ticks to wait for memory, 0 = forever
+    const char *traceFileName = NULL; // page reference trace, if any
+    Cache *iCache = NULL, *dCache = NULL, *l2Cache = NULL;
+    int l2Ticks = 0, memoryTicks = 0; // cache miss penalties
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
@@ -111,10 +122,56 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-sp")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "mlfq"))
+		policy = MlfqPolicy;
+	    else if (!strcmp(*(argv + 1), "fair"))
+		policy = FairPolicy;
+	    else
+		ASSERT(!strcmp(*(argv + 1), "priority"));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-sq")) {
+	    ASSERT(argc > 1);
+	    quantum = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-lp"))
+	    SynchProfile::enabled = TRUE;
+	else if (!strcmp(*argv, "-lt")) {
+	    ASSERT(argc > 1);
+	    synchFastTicks = atoi(*(argv + 1));
+	    argCount = 2;
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-mt")) {
+	    ASSERT(argc > 1);
+	    admissionTimeout = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tr")) {
+	    ASSERT(argc > 1);
+	    traceFileName = *(argv + 1);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-ci") || !strcmp(*argv, "-cd")
+		   || !strcmp(*argv, "-c2")) {
+	    ASSERT(argc > 3);		// size, associativity, line size
+	    Cache *cache = new Cache(!strcmp(*argv, "-ci") ? "L1 I-cache" :
+		!strcmp(*argv, "-cd") ? "L1 D-cache" : "L2 cache",
+		atoi(*(argv + 1)), atoi(*(argv + 2)), atoi(*(argv + 3)));
+	    if (!strcmp(*argv, "-ci"))
+		iCache = cache;
+	    else if (!strcmp(*argv, "-cd"))
+		dCache = cache;
+	    else
+		l2Cache = cache;
+	    argCount = 4;
+	} else if (!strcmp(*argv, "-cpen")) {
+	    ASSERT(argc > 2);		// L2 hit, memory access
+	    l2Ticks = atoi(*(argv + 1));
+	    memoryTicks = atoi(*(argv + 2));
+	    argCount = 3;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
@@ -136,8 +193,8 @@ Initialize(int argc, char **argv)
     DebugInit(debugArgs);			// initialize DEBUG messages
     stats = new Statistics();			// collect statistics
     interrupt = new Interrupt;			// start up interrupt handling
-    scheduler = new Scheduler();		// initialize the ready queue
-    if (randomYield)				// start the timer (if needed)
+    scheduler = new Scheduler(policy, quantum);	// initialize the ready queue
+    if (randomYield || policy != PriorityPolicy) // start the timer (if needed)
 	timer = new Timer(TimerInterruptHandler, 0, randomYield);
 
     threadToBeDestroyed = NULL;
@@ -153,9 +210,14 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     machine = new Machine(debugUserProg);	// this must come first
-    mm = new MemoryManager();
+    if (traceFileName != NULL)
+	machine->StartTrace(traceFileName);
+    machine->SetCaches(iCache, dCache, l2Cache, l2Ticks, memoryTicks);
+    mm = new MemoryManager(admissionTimeout);
     mmLock = new Lock("mmLock");
     pcbManager = new PCBManager(MAX_PROCESSES);
+    pageMerger = new PageMerger();
+    swapCache = new SwapCache();	// opens its file only when used
 #endif
 
 #ifdef FILESYS
@@ -184,6 +246,7 @@ Cleanup()
 #endif
 
 #ifdef USER_PROGRAM
+    delete swapCache;			// before the file system it uses
     delete machine;
 #endif
 
@@ -34,10 +34,14 @@ extern Timer *timer;				// the hardware alarm clock
 #include "memorymanager.h"
 #include "synch.h"
 #include "pcbmanager.h"
+#include "pagemerger.h"
+#include "swapcache.h"
 extern Machine* machine;	// user program memory and registers
 extern MemoryManager* mm;
 extern Lock* mmLock;
 extern PCBManager* pcbManager;
+extern PageMerger* pageMerger;
+extern SwapCache* swapCache;
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB
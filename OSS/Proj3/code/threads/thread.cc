@@ -23,6 +23,29 @@
 #define STACK_FENCEPOST 0xdeadbeef	// this is put at the top of the
 					// execution stack, for detecting 
 					// stack overflows
+#define STACK_FILL 0x5ca1ab1e		// the rest of the stack is filled
+					// with this, to find how deep it
+					// ever got
+
+// Stacks of threads that have been deleted, kept to be handed to
+// threads forked later with a stack of the same size, so that forking
+// a thread need not allocate a stack (and map its guard pages) each
+// time.  A stack in the pool is filled with STACK_FILL, except for
+// its first word, which links it to the next stack of its size.
+
+#define StackPoolSizes	4		// stack sizes we keep stacks of
+#define StackPoolDepth	64		// most stacks we keep of one size
+
+static struct {
+    int words;				// size of these stacks; 0 if unused
+    int count;				// stacks on the list
+    int *stacks;			// the list
+} stackPool[StackPoolSizes];
+
+static int stacksForked;		// stacks handed out by Fork
+static int stacksAllocated;		// ... of which, newly allocated
+static int deepestStack;		// most words any stack used
+static int deepestStackSize;		// ... out of how many
 
 //----------------------------------------------------------------------
 // Thread::Thread
@@ -37,7 +60,15 @@ Thread::Thread(const char* threadName)
     name = threadName;
     stackTop = NULL;
     stack = NULL;
+    stackSize = 0;
     status = JUST_CREATED;
+    basePriority = priority = DefaultPriority;
+    waitingFor = NULL;
+    heldLocks = NULL;
+    level = levelEpoch = 0;
+    sliceUsed = sliceStart = 0;
+    vruntime = 0;
+    heapIndex = -1;
 #ifdef USER_PROGRAM
     space = NULL;
 #endif
@@ -61,7 +92,7 @@ Thread::~Thread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	StackFree();
 }
 
 //----------------------------------------------------------------------
@@ -82,15 +113,16 @@ Thread::~Thread()
 // 	
 //	"func" is the procedure to run concurrently.
 //	"arg" is a single argument to be passed to the procedure.
+//	"stackWords" is the size of the thread's stack, in words.
 //----------------------------------------------------------------------
 
 void 
-Thread::Fork(VoidFunctionPtr func, int arg)
+Thread::Fork(VoidFunctionPtr func, int arg, int stackWords)
 {
     DEBUG('t', "Forking thread \"%s\" with func = 0x%x, arg = %d\n",
 	  name, (int) func, arg);
     
-    StackAllocate(func, arg);
+    StackAllocate(func, arg, stackWords);
 
     IntStatus oldLevel = interrupt->SetLevel(IntOff);
     scheduler->ReadyToRun(this);	// ReadyToRun assumes that interrupts 
@@ -118,12 +150,38 @@ Thread::CheckOverflow()
 {
     if (stack != NULL)
 #ifdef HOST_SNAKE			// Stacks grow upward on the Snakes
-	ASSERT(stack[StackSize - 1] == STACK_FENCEPOST);
+	ASSERT(stack[stackSize - 1] == STACK_FENCEPOST);
 #else
 	ASSERT((int) *stack == (int) STACK_FENCEPOST);
 #endif
 }
 
+//----------------------------------------------------------------------
+// Thread::StackUsed
+// 	Return how many words of our stack have ever been used: the
+//	words from the base of the stack to the deepest one that no
+//	longer holds STACK_FILL.  0 for the main thread, whose stack
+//	we did not allocate.
+//----------------------------------------------------------------------
+
+int
+Thread::StackUsed()
+{
+    int i;
+
+    if (stack == NULL)
+	return 0;
+#ifdef HOST_SNAKE			// Stacks grow upward on the Snakes
+    for (i = stackSize - 2; i >= 0 && stack[i] == (int) STACK_FILL; i--)
+	;
+    return i + 1;
+#else
+    for (i = 1; i < stackSize && stack[i] == (int) STACK_FILL; i++)
+	;
+    return stackSize - i;
+#endif
+}
+
 //----------------------------------------------------------------------
 // Thread::Finish
 // 	Called by ThreadRoot when a thread is done executing the 
@@ -169,6 +227,10 @@ Thread::Finish ()
 //	original state, in case we are called with interrupts disabled. 
 //
 // 	Similar to Thread::Sleep(), but a little different.
+//
+//	We go back on the ready list before the next thread is picked,
+//	so the CPU only goes to a thread of at least our priority; if
+//	there is none, we simply keep running.
 //----------------------------------------------------------------------
 
 void
@@ -181,11 +243,12 @@ Thread::Yield ()
     
     DEBUG('t', "Yielding thread \"%s\"\n", getName());
     
+    scheduler->ReadyToRun(this);
     nextThread = scheduler->FindNextToRun();
-    if (nextThread != NULL) {
-	scheduler->ReadyToRun(this);
+    if (nextThread != this)
 	scheduler->Run(nextThread);
-    }
+    else
+	status = RUNNING;
     (void) interrupt->SetLevel(oldLevel);
 }
 
@@ -218,13 +281,129 @@ Thread::Sleep ()
     
     DEBUG('t', "Sleeping thread \"%s\"\n", getName());
 
-    status = BLOCKED;
-    while ((nextThread = scheduler->FindNextToRun()) == NULL)
+    scheduler->Charge(this);	// for our time on the CPU, not the idle
+    status = BLOCKED;		// time until someone else can run
+    while ((nextThread = scheduler->FindNextToRun()) == NULL) {
+#ifdef USER_PROGRAM
+	pageMerger->IdleScan();	// put the idle time to use
+#endif
 	interrupt->Idle();	// no one to run, wait for an interrupt
+    }
         
     scheduler->Run(nextThread); // returns when we've been signalled
 }
 
+//----------------------------------------------------------------------
+// Thread::setPriority
+// 	Set the thread's own priority.  Any priority lent to it by
+//	threads waiting for its locks still counts, until they get them.
+//
+//	"newPriority" is between 0 and NumPriorities-1
+//----------------------------------------------------------------------
+
+void
+Thread::setPriority(int newPriority)
+{
+    ASSERT(newPriority >= 0 && newPriority < NumPriorities);
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    basePriority = newPriority;
+    RecomputePriority();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Thread::Donate
+// 	A thread of priority "donated" is waiting for a lock we hold, so
+//	run at (at least) that priority until we release it.  If we are
+//	blocked on a lock in turn, pass the priority on to its holder, so
+//	that a whole chain of holders gets out of the way.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+Thread::Donate(int donated)
+{
+    Thread *thread = this;
+
+    while (thread != NULL && donated > thread->priority) {
+	DEBUG('t', "Thread \"%s\" lends priority %d to \"%s\"\n",
+	      currentThread->getName(), donated, thread->getName());
+	thread->ChangePriority(donated);
+	thread = (thread->waitingFor != NULL) ?
+		    thread->waitingFor->getHolder() : NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// Thread::RecomputePriority
+// 	Go back to our own priority, or to that of the most urgent thread
+//	still waiting for one of the locks we hold, if that is higher.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+Thread::RecomputePriority()
+{
+    int newPriority = basePriority;
+
+    for (Lock *lock = heldLocks; lock != NULL; lock = lock->nextHeld)
+	if (lock->TopWaiterPriority() > newPriority)
+	    newPriority = lock->TopWaiterPriority();
+    ChangePriority(newPriority);
+}
+
+//----------------------------------------------------------------------
+// Thread::ChangePriority
+// 	Change the priority the scheduler goes by.  A thread on the ready
+//	list moves to the queue of its new priority; one waiting for a
+//	lock moves to its place among the lock's waiters.
+//----------------------------------------------------------------------
+
+void
+Thread::ChangePriority(int newPriority)
+{
+    if (newPriority == priority)
+	return;
+    if (status == READY) {
+	scheduler->RemoveThread(this);
+	priority = newPriority;
+	scheduler->ReadyToRun(this);
+    } else {
+	priority = newPriority;
+	if (status == BLOCKED && waitingFor != NULL)
+	    waitingFor->Requeue(this);
+    }
+}
+
+//----------------------------------------------------------------------
+// Thread::Unqueue
+// 	Take this thread off the ready list, or off the wait queue of
+//	whatever it is blocked on, without waking it up: it is being
+//	killed, and the queue may go away before it would have woken.
+//	If it was waiting for a lock, the holder gets back the priority
+//	it lent.
+//
+//	Called with interrupts disabled.
+//----------------------------------------------------------------------
+
+void
+Thread::Unqueue()
+{
+    if (status == READY) {
+	scheduler->RemoveThread(this);
+    } else if (waitingFor != NULL) {
+	Lock *lock = waitingFor;
+
+	waitingFor = NULL;
+	lock->Cancel(this);
+    } else if (queueLink.list != NULL) {
+	((ThreadList *) queueLink.list)->RemoveItem(this);
+    }
+}
+
 //----------------------------------------------------------------------
 // ThreadFinish, InterruptEnable, ThreadPrint
 //	Dummy functions because C++ does not allow a pointer to a member
@@ -245,26 +424,47 @@ void ThreadPrint(int arg){ Thread *t = (Thread *)arg; t->Print(); }
 //		calls (*func)(arg)
 //		calls Thread::Finish
 //
+//	The stack comes from the pool if there is one of the right size
+//	there; it is already filled with STACK_FILL.  Otherwise we
+//	allocate one, and fill it.
+//
 //	"func" is the procedure to be forked
 //	"arg" is the parameter to be passed to the procedure
+//	"stackWords" is the size of the stack, in words
 //----------------------------------------------------------------------
 
 void
-Thread::StackAllocate (VoidFunctionPtr func, int arg)
+Thread::StackAllocate (VoidFunctionPtr func, int arg, int stackWords)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    ASSERT(stack == NULL && stackWords >= MinStackSize);
+    stackSize = stackWords;
+    stacksForked++;
+    for (int i = 0; i < StackPoolSizes; i++)
+	if (stackPool[i].words == stackSize && stackPool[i].count > 0) {
+	    stack = stackPool[i].stacks;
+	    stackPool[i].stacks = *(int **) stack;
+	    stackPool[i].count--;
+	    stack[0] = STACK_FILL;
+	    break;
+	}
+    if (stack == NULL) {
+	stack = (int *) AllocBoundedArray(stackSize * sizeof(int));
+	for (int i = 0; i < stackSize; i++)
+	    stack[i] = STACK_FILL;
+	stacksAllocated++;
+    }
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
     stackTop = stack + 16;	// HP requires 64-byte frame marker
-    stack[StackSize - 1] = STACK_FENCEPOST;
+    stack[stackSize - 1] = STACK_FENCEPOST;
 #else
     // i386 & MIPS & SPARC stack works from high addresses to low addresses
 #ifdef HOST_SPARC
     // SPARC stack must contains at least 1 activation record to start with.
-    stackTop = stack + StackSize - 96;
+    stackTop = stack + stackSize - 96;
 #else  // HOST_MIPS  || HOST_i386
-    stackTop = stack + StackSize - 4;	// -4 to be on the safe side!
+    stackTop = stack + stackSize - 4;	// -4 to be on the safe side!
 #ifdef HOST_i386
     // the 80386 passes the return address on the stack.  In order for
     // SWITCH() to go to ThreadRoot when we switch to this thread, the
@@ -283,6 +483,71 @@ Thread::StackAllocate (VoidFunctionPtr func, int arg)
     machineState[WhenDonePCState] = (int) ThreadFinish;
 }
 
+//----------------------------------------------------------------------
+// Thread::StackFree
+//	Give our stack back: note how deep it got, fill the part of it
+//	that was used with STACK_FILL again, and put it in the pool.
+//	If the pool has no room for it, de-allocate it instead.
+//----------------------------------------------------------------------
+
+void
+Thread::StackFree()
+{
+    int used = StackUsed();
+    int *dirty;				// the words we must fill again
+    int slot = -1;
+
+    DEBUG('t', "Thread \"%s\" used %d of %d stack words\n", name, used,
+	  stackSize);
+    // deepest as a share of the stack size, so sizes can be mixed
+    if (deepestStackSize == 0
+		|| used * deepestStackSize > deepestStack * stackSize) {
+	deepestStack = used;
+	deepestStackSize = stackSize;
+    }
+
+    for (int i = 0; i < StackPoolSizes; i++)
+	if (stackPool[i].words == stackSize
+		|| (slot < 0 && stackPool[i].words == 0))
+	    slot = i;
+    if (slot < 0 || stackPool[slot].count == StackPoolDepth) {
+	DeallocBoundedArray((char *) stack, stackSize * sizeof(int));
+	stack = NULL;
+	return;
+    }
+
+#ifdef HOST_SNAKE
+    dirty = stack;
+#else
+    dirty = stack + stackSize - used;
+#endif
+    for (int i = 0; i < used; i++)
+	dirty[i] = STACK_FILL;
+    stack[0] = stack[stackSize - 1] = STACK_FILL;	// the fenceposts
+
+    stackPool[slot].words = stackSize;
+    *(int **) stack = stackPool[slot].stacks;
+    stackPool[slot].stacks = stack;
+    stackPool[slot].count++;
+    stack = NULL;
+}
+
+//----------------------------------------------------------------------
+// Thread::PrintStacks
+//	Print how many thread stacks were handed out, how many of those
+//	had to be allocated rather than taken from the pool, and the
+//	deepest any of them got, of the threads that are gone.
+//----------------------------------------------------------------------
+
+void
+Thread::PrintStacks()
+{
+    if (stacksForked == 0)
+	return;
+    printf("Thread stacks: %d forked, %d allocated, deepest %d of %d words\n",
+	   stacksForked, stacksAllocated, deepestStack, deepestStackSize);
+}
+
 #ifdef USER_PROGRAM
 #include "machine.h"
 
@@ -39,6 +39,8 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "dlist.h"
+#include "objcache.h"
 
 #ifdef USER_PROGRAM
 #include "machine.h"
@@ -52,14 +54,22 @@ class AddrSpace;
 #define MachineStateSize 18 
 
 
-// Size of the thread's private execution stack.
+// Size of the thread's private execution stack, unless Fork is
+// asked for another size.
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 #define StackSize	(4 * 1024)	// in words
+#define MinStackSize	1024		// smallest Fork will give out
 
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
 
+// Thread priorities, from 0 (lowest) to NumPriorities-1 (highest)
+#define NumPriorities	32
+#define DefaultPriority	(NumPriorities / 2)
+
+class Lock;
+
 // external function, dummy routine whose sole job is to call Thread::Print
 extern void ThreadPrint(int arg);	 
 
@@ -87,10 +97,13 @@ class Thread {
 					// NOTE -- thread being deleted
 					// must not be running when delete 
 					// is called
+    CACHED_OBJECTS(Thread)
 
     // basic thread operations
 
-    void Fork(VoidFunctionPtr func, int arg); 	// Make thread run (*func)(arg)
+    void Fork(VoidFunctionPtr func, int arg, int stackWords = StackSize);
+						// Make thread run (*func)(arg),
+						// on a stack of "stackWords"
     void Yield();  				// Relinquish the CPU if any 
 						// other thread is runnable
     void Sleep();  				// Put the thread to sleep and 
@@ -99,22 +112,59 @@ class Thread {
     
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
+    int StackUsed();				// Deepest our stack has
+						// been, in words
+    static void PrintStacks();			// Print how stacks were used
     void setStatus(ThreadStatus st) { status = st; }
+    ThreadStatus getStatus() { return status; }
     const char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
 
+    // priority scheduling, with priority inheritance through Locks
+    int getPriority() { return priority; }	// including any donation
+    int getBasePriority() { return basePriority; }
+    void setPriority(int newPriority);	// set our own priority
+    void Donate(int donated);		// a thread waiting for a lock we
+					// hold lends us its priority
+    void RecomputePriority();		// a donation may be over
+    void Unqueue();			// off any queue, without waking up
+
+    Lock *waitingFor;			// the lock we are blocked on
+    Lock *heldLocks;			// locks we hold, linked through
+					// Lock::nextHeld
+
+    // for the multilevel feedback queue scheduler
+    int level;				// 0 is the top (shortest quantum)
+    int levelEpoch;			// "level" is stale after a reset
+    int sliceUsed;			// ticks of our time slice used up
+    int sliceStart;			// when we last got the CPU
+
+    // for the fair scheduler
+    int vruntime;			// CPU time used, scaled down by our
+					// weight
+    int heapIndex;			// where we are in the ready heap
+
+    DListLink<Thread> queueLink;	// on the ready list, or the wait
+					// queue of a synchronization object
+
   private:
     // some of the private data for this class is listed above
     
     int* stack; 	 		// Bottom of the stack 
 					// NULL if this is the main thread
 					// (If NULL, don't deallocate stack)
+    int stackSize;			// in words
     ThreadStatus status;		// ready, running or blocked
     const char* name;
+    int basePriority;			// set by setPriority
+    int priority;			// what the scheduler goes by
 
-    void StackAllocate(VoidFunctionPtr func, int arg);
+    void ChangePriority(int newPriority); // move to another ready queue
+
+    void StackAllocate(VoidFunctionPtr func, int arg, int stackWords);
     					// Allocate a stack for thread.
 					// Used internally by Fork()
+    void StackFree();			// Give the stack back to the pool
 
 #ifdef USER_PROGRAM
 // A thread running a user program actually has *two* sets of CPU registers -- 
@@ -131,6 +181,11 @@ class Thread {
 #endif
 };
 
+// A list of threads, such as the ready list or a wait queue, linked
+// through their queueLink.  A thread is on at most one at a time.
+
+typedef DList<Thread, &Thread::queueLink> ThreadList;
+
 // Magical machine-dependent routines, defined in switch.s
 
 extern "C" {
@@ -59,21 +59,33 @@ ThreadTest1()
 
 #ifdef HW1_SEMAPHORES
 
-int numThreadsActive; // used to implement barrier upon completion
+#include "synch.h"
+
+CountDownLatch *threadsDone;	// opens once every forked thread is done
+
+void
+CountedThread(int which)
+{
+    SimpleThread(which);
+    threadsDone->CountDown();
+}
 
 void
 ThreadTest(int n) {
     DEBUG('t', "Entering SimpleTest");
     Thread *t;
-    numThreadsActive = n;
-    printf("NumthreadsActive = %d\n", numThreadsActive);
+    threadsDone = new CountDownLatch("threads done", n - 1);
+    printf("NumthreadsActive = %d\n", n);
 
     for(int i=1; i<n; i++)
     {
         t = new Thread("forked thread");
-        t->Fork(SimpleThread,i);
+        t->Fork(CountedThread,i);
     }
     SimpleThread(0);
+    threadsDone->Wait();
+    printf("All %d threads done\n", n);
+    delete threadsDone;
 }
 
 #else 
@@ -18,11 +18,20 @@
 #include "copyright.h"
 #include "system.h"
 #include "addrspace.h"
-#include "noff.h"
 #ifdef HOST_SPARC
 #include <strings.h>
 #endif
 
+#ifdef USE_TLB
+// Address space identifiers.  The TLB keeps the entries of every
+// address space, tagged with its ASID, across context switches.  When
+// the ASIDs run out, a new generation starts: the TLB is flushed, and
+// each address space gets a fresh ASID the next time it runs.
+static AddrSpace *asidOwner[NumAsids];	// who holds each ASID
+static int currentGeneration = 1;
+static int nextAsid = 0;
+#endif
+
 //----------------------------------------------------------------------
 // SwapHeader
 // 	Do little endian to big endian conversion on the bytes in the
@@ -48,30 +57,44 @@ SwapHeader (NoffHeader *noffH)
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
-//	Load the program from a file "executable", and set everything
+//	Load the program from a file "programFile", and set everything
 //	up so that we can start executing user instructions.
 //
 //	Assumes that the object code file is in NOFF format.
 //
-//	First, set up the translation from program memory to physical
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	No page is loaded here: every page table entry starts out
+//	invalid, and code and data are read in from "programFile" on the
+//	first fault, a cluster of pages at a time.  The address space
+//	keeps "programFile" open for that, and closes it when it goes away.
 //
-//	"executable" is the file containing the object code to load into memory
+//	"programFile" is the file containing the object code to load into memory
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable, PCB *temppcb)
+AddrSpace::AddrSpace(OpenFile *programFile, PCB *temppcb)
 {
     NoffHeader noffH;
     unsigned int i, size;
 
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
+    for (i = 0; i < MaxMmapRegions; i++)
+        mmapRegions[i].inUse = FALSE;
+    executable = NULL;
+    pageTable = NULL;			// so a failed space can be deleted
+    shared = NULL;
+    swapSlot = NULL;
+    numPages = 0;
+    lastFaultEnd = 0;
+    clusterSize = 1;
+    asid = -1;				// assigned when it first runs
+    asidGeneration = 0;
+
+    programFile->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) &&
 		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
     	SwapHeader(&noffH);
 
 
     if(noffH.noffMagic != NOFFMAGIC) {
+        delete programFile;
         valid = false;
         return;
     }
@@ -81,19 +104,27 @@ AddrSpace::AddrSpace(OpenFile *executable, PCB *temppcb)
     // printf("noffH.noffMagic == NOFFMAGIC\n");
 
 // how big is address space?
-    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size
-			+ UserStackSize;	// we need to increase the size
-						// to leave room for the stack
-    // printf("size = %d\n", size);
-    numPages = divRoundUp(size, PageSize);
+    size = noffH.code.size + noffH.initData.size + noffH.uninitData.size;
+    imagePages = divRoundUp(size, PageSize);
+    // the stack gets room to grow down to MaxStackPages, plus the
+    // guard page that stays below it even then
+    numPages = imagePages + 1 + MaxStackPages;
     // printf("numPages = %d\n", numPages);
     // printf("PageSize = %d\n", PageSize);
     size = numPages * PageSize;
     // printf("size = numPages * PageSize = %d\n", size);
+    stackTop = size;
+    stackBottom = numPages - divRoundUp(UserStackSize, PageSize);
+    heapBase = numPages;
+    heapBreak = heapBase * PageSize;
+    mmapBase = heapBase + MaxHeapPages;
 
     // printf("mm->GetFreePageCount() = %d\n", mm->GetFreePageCount());
 
-    if(numPages > mm->GetFreePageCount()) {
+    // wait (in line) for room to run the program
+    if(!mm->WaitForPages(imagePages + numPages - stackBottom)) {
+        delete programFile;
+        numPages = 0;			// there is no page table to free
         valid = false;
         return;
     }
@@ -112,47 +143,28 @@ AddrSpace::AddrSpace(OpenFile *executable, PCB *temppcb)
 					numPages, size);
 // first, set up the translation
     pageTable = new TranslationEntry[numPages];
+    shared = new bool[numPages];
+    swapSlot = new int[numPages];
     for (i = 0; i < numPages; i++) {
+        shared[i] = FALSE;
+        swapSlot[i] = NotSwapped;
         pageTable[i].virtualPage = i;	// for now, virtual page # = phys page #
-        pageTable[i].physicalPage = mm->AllocatePage();
-        pageTable[i].valid = TRUE;
+        pageTable[i].physicalPage = 0;
+        pageTable[i].valid = FALSE;	// paged in on first touch
         pageTable[i].use = FALSE;
         pageTable[i].dirty = FALSE;
+        pageTable[i].superPage = FALSE;
         pageTable[i].readOnly = FALSE;  // if the code segment was entirely on
                         // a separate page, we could set its
                         // pages to be read-only
-
-        // Zero out each page, to zero the unitialized data segment
-        // and the stack segment
-        unsigned int physicalPageAddress = (pageTable[i].physicalPage)*128;
-        bzero(&(machine->mainMemory[physicalPageAddress]), 128);
     }
 
-     // then, copy in the code and data segments into memory
-    if (noffH.code.size > 0) {
-        DEBUG('a', "Initializing code segment, at 0x%x, size %d\n",
-			noffH.code.virtualAddr, noffH.code.size);
-        int counter = 0;
-        while( counter < noffH.code.size) {
-
-            executable->ReadAt(&(machine->mainMemory[Translate(noffH.code.virtualAddr+counter)]),
-                1, noffH.code.inFileAddr+counter);
-            counter++;
-        }
-    }
-    if (noffH.initData.size > 0) {
-        DEBUG('a', "Initializing data segment, at 0x%x, size %d\n",
-			noffH.initData.virtualAddr, noffH.initData.size);
-        int counter = 0;
-        while( counter < noffH.initData.size) {
-        	executable->ReadAt(&(machine->mainMemory[Translate(noffH.initData.virtualAddr+counter)]),
-				1, noffH.initData.inFileAddr+counter);
-            counter++;
-        }
-
-    }
+    executable = programFile;
+    codeSeg = noffH.code;
+    dataSeg = noffH.initData;
 
     valid = true;
+    pageMerger->AddSpace(this);
 
 
 }
@@ -179,26 +191,86 @@ AddrSpace::AddrSpace(AddrSpace* space, PCB *temppcb) {
     // 1. Find how big the source address space is
     unsigned int n = space->GetNumPages();
 
-    // Acquire mmLock
-    mmLock->Acquire();
+    // The child does not get the executable, so bring the parent's
+    // whole program image in first
+    space->FaultIn(0, space->imagePages * PageSize);
+    executable = NULL;
+    codeSeg = space->codeSeg;
+    dataSeg = space->dataSeg;
+    lastFaultEnd = 0;
+    clusterSize = 1;
+    asid = -1;				// assigned when it first runs
+    asidGeneration = 0;
 
-    // 2. Check if there is enough free memory to make the copy. IF not, fail
-    ASSERT(n <= mm->GetFreePageCount());
-    // Change this to informiing caller that constructor failed using valid=false;
+    // Mapped files are not shared with the child; it gets a private
+    // copy of their contents, so bring every mapped page in first
+    for (int r = 0; r < MaxMmapRegions; r++) {
+        mmapRegions[r] = space->mmapRegions[r];
+        mmapRegions[r].file = NULL;
+        mmapRegions[r].ownsFile = FALSE;
+        if (mmapRegions[r].inUse)
+            space->FaultIn(mmapRegions[r].startPage * PageSize,
+                           mmapRegions[r].numPages * PageSize);
+    }
 
     // 3. Create a new pagetable of same size as source addr space
     pageTable = new TranslationEntry[n];
+    shared = new bool[n];
+    swapSlot = new int[n];
     numPages = n;
+    for (int i = 0; i < numPages; i++) {
+        pageTable[i].valid = FALSE;
+        shared[i] = FALSE;
+        swapSlot[i] = NotSwapped;
+    }
 
-    // 4. Make a copy of the PTEs but allocate new physical pages
+    // 2. Wait for enough free memory to make the copy. IF it never
+    // comes, or is gone again by the time we hold mmLock, fail
     TranslationEntry* ppt = space->GetPageTable();
-    for (int i = 0; i < numPages; i++) {
+    unsigned int resident = 0;
+    for (unsigned int i = 0; i < numPages; i++)
+        if (ppt[i].valid)
+            resident++;
+    bool admitted = mm->WaitForPages(resident);
+
+    // Acquire mmLock
+    mmLock->Acquire();
+
+    if (!admitted || resident > mm->GetFreePageCount()) {
+        for (int r = 0; r < MaxMmapRegions; r++)
+            mmapRegions[r].inUse = FALSE;
+        valid = false;
+        mmLock->Release();
+        return;
+    }
+
+    imagePages = space->imagePages;
+    stackTop = space->stackTop;
+    stackBottom = space->stackBottom;
+    heapBase = space->heapBase;
+    heapBreak = space->heapBreak;
+    mmapBase = space->mmapBase;
+
+    // 4. Make a copy of the PTEs but allocate new physical pages
+    unsigned int i;
+    for (i = 0; i < numPages; i++) {
         pageTable[i].virtualPage = ppt[i].virtualPage;
+        pageTable[i].superPage = FALSE;
+        if (!ppt[i].valid) {		// hole, or paged out
+            pageTable[i].valid = FALSE;
+            if (space->swapSlot[i] >= 0) {
+                swapSlot[i] = swapCache->Duplicate(space->swapSlot[i]);
+                if (swapSlot[i] == NotSwapped)	// no room left in swap
+                    break;
+            }
+            continue;
+        }
         pageTable[i].physicalPage = mm->AllocatePage();
+        mm->SetOwner(pageTable[i].physicalPage, this, i);
         pageTable[i].valid = ppt[i].valid;
         pageTable[i].use = ppt[i].use;
         pageTable[i].dirty = ppt[i].dirty;
-        pageTable[i].readOnly = ppt[i].readOnly;
+        pageTable[i].readOnly = ppt[i].readOnly && !space->shared[i];
 
         // 5. For each page, make an actual copy of the contents of the page
         bcopy(  &(machine->mainMemory[ppt[i].physicalPage*128]),
@@ -209,21 +281,56 @@ AddrSpace::AddrSpace(AddrSpace* space, PCB *temppcb) {
     // Release mmLock
     mmLock->Release();
 
+    // The copy of a paged out page had nowhere to go.  Fail the fork;
+    // deleting us gives back the frames and slots copied so far
+    if (i < numPages) {
+        for (int r = 0; r < MaxMmapRegions; r++)
+            mmapRegions[r].inUse = FALSE;
+        valid = false;
+        return;
+    }
+
+    pageMerger->AddSpace(this);
 }
 
 
 
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
-// 	Dealloate an address space.  Nothing for now!
+// 	Dealloate an address space.  Mapped files get their dirty pages
+//	written back before the frames are released.
+//
+//	Another thread's fault may be paging one of our pages out right
+//	now, holding mmLock while it waits for the swap disk; taking
+//	mmLock waits for that to finish, so that we free the swap slot
+//	it ends up in rather than it writing into our freed table.
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace()
 {
-    for (int i = 0; i < numPages; i++) {
-        mm->DeallocatePage(pageTable[i].physicalPage);
+    pageMerger->RemoveSpace(this);
+    UnmapAll();
+#ifdef USE_TLB
+    if (asidGeneration == currentGeneration) {	// forget our entries
+        for (int i = 0; i < TLBSize; i++)
+            if (machine->tlb[i].asid == asid)
+                machine->tlb[i].valid = FALSE;
+        asidOwner[asid] = NULL;
     }
-   delete pageTable;
+#endif
+    mmLock->Acquire();
+    for (unsigned int i = 0; i < numPages; i++) {
+        if (pageTable[i].valid)
+            mm->DeallocatePage(pageTable[i].physicalPage);
+        else if (swapSlot[i] >= 0)
+            swapCache->Free(swapSlot[i]);
+    }
+    mm->ForgetOwner(this);		// frames still shared with others
+    mmLock->Release();
+   delete [] pageTable;
+   delete [] shared;
+   delete [] swapSlot;
+   delete executable;			// close file
 }
 
 //----------------------------------------------------------------------
@@ -254,8 +361,8 @@ AddrSpace::InitRegisters()
    // Set the stack register to the end of the address space, where we
    // allocated the stack; but subtract off a bit, to make sure we don't
    // accidentally reference off the end!
-    machine->WriteRegister(StackReg, numPages * PageSize - 16);
-    DEBUG('a', "Initializing stack register to %d\n", numPages * PageSize - 16);
+    machine->WriteRegister(StackReg, stackTop - 16);
+    DEBUG('a', "Initializing stack register to %d\n", stackTop - 16);
 }
 
 //----------------------------------------------------------------------
@@ -274,39 +381,960 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      Without a TLB, tell the machine where to find the page table.
+//	With one, just tell it our ASID; whatever of our translations
+//	is still in the TLB can be used again.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState()
 {
+#ifdef USE_TLB
+    AssignAsid();
+    machine->asid = asid;
+#else
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AssignAsid
+// 	Make sure we hold an ASID of the current generation.  Once they
+//	are all handed out, start a new generation: flush the TLB, so no
+//	entry carries an ASID that is about to be reused.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::AssignAsid()
+{
+#ifdef USE_TLB
+    if (asidGeneration == currentGeneration)
+        return;
+
+    if (nextAsid == NumAsids) {
+        SyncTLB();
+        for (int i = 0; i < TLBSize; i++)
+            machine->tlb[i].valid = FALSE;
+        for (int i = 0; i < NumAsids; i++)
+            asidOwner[i] = NULL;
+        currentGeneration++;
+        nextAsid = 0;
+        stats->numTLBFlushes++;
+    }
+    asid = nextAsid++;
+    asidGeneration = currentGeneration;
+    asidOwner[asid] = this;
+    DEBUG('a', "Address space given ASID %d\n", asid);
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadTLB
+// 	Handle a TLB miss on "virtAddr": page it in if need be, then copy
+//	its page table entry into the TLB.  An empty TLB slot is used if
+//	there is one, otherwise the slots are replaced round robin.
+//
+//	Returns FALSE if "virtAddr" is not mapped.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::LoadTLB(int virtAddr)
+{
+#ifdef USE_TLB
+    static int nextVictim = 0;
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+
+    if (vpn >= numPages)
+        return FALSE;
+    if (!pageTable[vpn].valid && !HandlePageFault(virtAddr))
+        return FALSE;
+
+    int slot;
+    for (slot = 0; slot < TLBSize; slot++)
+        if (!machine->tlb[slot].valid)
+            break;
+    if (slot == TLBSize) {
+        slot = nextVictim;
+        nextVictim = (nextVictim + 1) % TLBSize;
+        TranslationEntry *victim = &machine->tlb[slot];
+        if (asidOwner[victim->asid] != NULL)
+            asidOwner[victim->asid]->MergeTLBBits(victim);
+    }
+
+    if (pageTable[vpn].superPage)	// one entry maps all of it
+        vpn -= vpn % SuperPagePages;
+    machine->tlb[slot] = pageTable[vpn];
+    machine->tlb[slot].asid = asid;
+    stats->numTLBMisses++;
+    return TRUE;
+#else
+    return HandlePageFault(virtAddr);
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SyncTLB
+// 	The hardware sets the use and dirty bits in the TLB entry, not in
+//	the page table.  Copy them back, for whoever looks at the page
+//	tables: the page replacement clock, and write back of mappings.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SyncTLB()
+{
+#ifdef USE_TLB
+    for (int i = 0; i < TLBSize; i++) {
+        TranslationEntry *entry = &machine->tlb[i];
+        if (!entry->valid)		// its asid means nothing
+            continue;
+        AddrSpace *owner = asidOwner[entry->asid];
+        if (owner == NULL)
+            continue;
+        owner->MergeTLBBits(entry);
+        entry->use = FALSE;		// counted now
+    }
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InvalidateTLB
+// 	Page "vpn"'s page table entry is about to change: drop its stale
+//	copy from the TLB, keeping the bits the hardware set in it.
+//	Only this one entry is flushed, never the whole TLB.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InvalidateTLB(unsigned int vpn)
+{
+#ifdef USE_TLB
+    if (asidGeneration != currentGeneration)
+        return;			// flushed with our old ASID
+    for (int i = 0; i < TLBSize; i++) {
+        TranslationEntry *entry = &machine->tlb[i];
+        if (entry->valid && entry->asid == asid
+                && (entry->superPage ?
+                    vpn - entry->virtualPage < SuperPagePages :
+                    entry->virtualPage == vpn)) {
+            MergeTLBBits(entry);
+            entry->valid = FALSE;
+        }
+    }
+#endif
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::MergeTLBBits
+// 	Copy the use and dirty bits of our TLB "entry" back into the page
+//	table.  An entry for a superpage stands for all of its pages.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::MergeTLBBits(TranslationEntry *entry)
+{
+    unsigned int count = entry->superPage ? SuperPagePages : 1;
+
+    for (unsigned int vpn = entry->virtualPage;
+            vpn < entry->virtualPage + count && vpn < numPages; vpn++) {
+        pageTable[vpn].use |= entry->use;
+        pageTable[vpn].dirty |= entry->dirty;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PromoteSuperPage
+// 	Turn the SuperPagePages pages starting at "first" into a
+//	superpage, once all of them are resident, private, and alike.
+//	If their frames are not already in a row, the pages are moved
+//	into a fresh run of aligned frames -- as long as one is free;
+//	nothing is paged out for the sake of a superpage.
+//
+//	Pages of mapped files are never promoted, since they are written
+//	back one page at a time.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::PromoteSuperPage(unsigned int first)
+{
+    unsigned int vpn;
+    bool inPlace;
+
+    if (first % SuperPagePages != 0 || first + SuperPagePages > numPages
+            || pageTable[first].superPage)
+        return;
+
+    mmLock->Acquire();			// nobody pages them out meanwhile
+    inPlace = (pageTable[first].physicalPage % SuperPagePages == 0);
+    for (vpn = first; vpn < first + SuperPagePages; vpn++) {
+        if (!pageTable[vpn].valid || shared[vpn]
+                || pageTable[vpn].readOnly != pageTable[first].readOnly
+                || FindRegion(vpn) != NULL) {
+            mmLock->Release();
+            return;
+        }
+        if (pageTable[vpn].physicalPage
+                != pageTable[first].physicalPage + (vpn - first))
+            inPlace = FALSE;
+    }
+
+    int base = -1;
+    if (!inPlace && (base = mm->AllocateSuperPage()) == -1) {
+        mmLock->Release();
+        return;
+    }
+    for (vpn = first; vpn < first + SuperPagePages; vpn++) {
+        InvalidateTLB(vpn);
+        if (!inPlace) {
+            int old = pageTable[vpn].physicalPage;
+            int frame = base + (vpn - first);
+            bcopy(&(machine->mainMemory[old * PageSize]),
+                  &(machine->mainMemory[frame * PageSize]), PageSize);
+            pageTable[vpn].physicalPage = frame;
+            mm->SetOwner(frame, this, vpn);
+            mm->DeallocatePage(old);
+        }
+        pageTable[vpn].superPage = TRUE;
+    }
+    mmLock->Release();
+    stats->numSuperPagesPromoted++;
+    DEBUG('a', "Pages %d to %d promoted to a superpage at frame %d\n",
+            first, first + SuperPagePages - 1, pageTable[first].physicalPage);
+}
 
-// perform MMU translation to access physical memory
-unsigned int AddrSpace::Translate(unsigned int virtualAddr) {
+//----------------------------------------------------------------------
+// AddrSpace::DemoteSuperPage
+// 	Split the superpage holding "vpn" back into ordinary pages, before
+//	one of them is changed on its own: unmapped, paged out, merged or
+//	copied on write.  The pages keep their frames.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::DemoteSuperPage(unsigned int vpn)
+{
+    if (vpn >= numPages || !pageTable[vpn].superPage)
+        return;
+
+    unsigned int first = vpn - vpn % SuperPagePages;
+    InvalidateTLB(first);		// the TLB maps it as a whole
+    for (vpn = first; vpn < first + SuperPagePages; vpn++)
+        pageTable[vpn].superPage = FALSE;
+    stats->numSuperPagesDemoted++;
+    DEBUG('a', "Superpage at page %d demoted\n", first);
+}
+
+
+// perform MMU translation to access physical memory, paging the
+// page in first; -1 if the address is not mapped, or there is no frame
+int AddrSpace::Translate(unsigned int virtualAddr) {
         unsigned int pageNumber = virtualAddr/PageSize;
         unsigned int pageOffset = virtualAddr%PageSize;
+        if (!FaultIn(virtualAddr, 1))
+            return -1;
         unsigned int frameNumber = pageTable[pageNumber].physicalPage;
         int physicalAddr = frameNumber*PageSize + pageOffset;
         return physicalAddr;
 }
 
-void AddrSpace::getString(char *str, int virtAd)
+// copy the string at virtAd into str, which has room for 256 bytes;
+// FALSE if it runs into an address that is not mapped
+bool AddrSpace::getString(char *str, int virtAd)
 {
     int i = 0;
     int physAd = Translate(virtAd);
+    if (physAd == -1) {
+        str[0] = '\0';
+        return FALSE;
+    }
     bcopy(&(machine->mainMemory[physAd]), &str[i], 1);
     while (str[i] != '\0' && i != 256-1){
         virtAd++;
         i++;
         physAd = Translate(virtAd);
+        if (physAd == -1) {
+            str[0] = '\0';
+            return FALSE;
+        }
         bcopy(&(machine->mainMemory[physAd]), &str[i], 1);
     }
-    if (i != 256-1 && str[i] != '\0')
+    if (i == 256-1 && str[i] != '\0')
     {
       str[i] = '\0';
     }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FaultIn
+// 	Make every page of the user buffer [virtAddr, virtAddr+size)
+//	resident, so that the kernel can copy to or from it without
+//	taking a page fault half way through a system call.  If the
+//	kernel is "writing" the buffer, shared pages get private copies
+//	too, since the kernel does not go through the read-only check.
+//
+//	Returns FALSE if some page of the buffer is not mapped.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::FaultIn(int virtAddr, int size, bool writing)
+{
+    if (size <= 0)
+        return TRUE;
+    unsigned int first = (unsigned) virtAddr / PageSize;
+    unsigned int last = (unsigned) (virtAddr + size - 1) / PageSize;
+    for (unsigned int vpn = first; vpn <= last; vpn++) {
+        if (vpn >= numPages)
+            return FALSE;
+        if (!pageTable[vpn].valid && !HandlePageFault(vpn * PageSize))
+            return FALSE;
+        if (writing && shared[vpn] && !UnsharePage(vpn))
+            return FALSE;
+        pageTable[vpn].use = TRUE;	// keep the clock off it for now
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HandlePageFault
+// 	Bring in the page holding "virtAddr", together with up to
+//	clusterSize-1 pages after it in the same segment, so that a
+//	program walking through memory traps once per cluster instead of
+//	once per page.  The cluster doubles, up to MaxClusterPages, each
+//	time a fault lands on the page just past the previous cluster,
+//	and falls back to a single page on any other fault.  Pages past
+//	the faulting one are only read in while there are free frames.
+//
+//	Every page of the cluster is zeroed; code and data pages of the
+//	program, and pages of a mapped file, are then filled from their
+//	file with one read per segment.
+//
+//	Returns FALSE if the address is not mapped, or there is no free
+//	frame; the caller should then kill the process.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::HandlePageFault(int virtAddr)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    unsigned int segEnd;		// page just past vpn's segment
+    MmapRegion *region = NULL;
+
+    if (vpn >= numPages)
+        return FALSE;
+    if (pageTable[vpn].valid)		// already brought in
+        return TRUE;
+    if (swapSlot[vpn] != NotSwapped)
+        return SwapIn(vpn);
+
+    if (vpn < imagePages)
+        segEnd = imagePages;		// the program image
+    else if (vpn < heapBase) {
+        if (vpn < stackBottom && !GrowStack(vpn))
+            return FALSE;
+        segEnd = heapBase;		// the stack
+    } else if (vpn * PageSize < heapBreak)
+        segEnd = divRoundUp(heapBreak, PageSize);
+    else {
+        region = FindRegion(vpn);
+        if (region == NULL)
+            return FALSE;
+        segEnd = region->startPage + region->numPages;
+    }
+
+    // follow the fault stream
+    if (vpn == lastFaultEnd)
+        clusterSize = min(clusterSize * 2, MaxClusterPages);
+    else
+        clusterSize = 1;
+
+    // the faulting page must get a frame, the rest only if one is free
+    unsigned int last;
+    mmLock->Acquire();
+    for (last = vpn; last < vpn + clusterSize && last < segEnd
+            && !pageTable[last].valid && swapSlot[last] == NotSwapped;
+            last++) {
+        int frame;
+        if (last == vpn)
+            frame = AllocateFrame(last);
+        else if (mm->GetFreePageCount() > 0) {
+            frame = mm->AllocatePage();
+            mm->SetOwner(frame, this, last);
+        } else
+            break;
+        if (frame == -1)
+            break;
+        pageTable[last].physicalPage = frame;
+    }
+    mmLock->Release();
+    if (last == vpn)
+        return FALSE;
+
+    DEBUG('a', "Page fault at 0x%x, loading pages %d to %d\n",
+            virtAddr, vpn, last - 1);
+    stats->numPageFaults++;
+    stats->numPagesPrefetched += last - vpn - 1;
+    lastFaultEnd = last;
+
+    // read the whole cluster at once, then hand it out to the frames
+    char *buffer = new char[(last - vpn) * PageSize];
+    bzero(buffer, (last - vpn) * PageSize);
+    if (region != NULL && region->file != NULL) {
+        int offset = (vpn - region->startPage) * PageSize;
+        int bytes = min((int) ((last - vpn) * PageSize),
+                        region->length - offset);
+        if (bytes > 0)
+            region->file->ReadAt(buffer, bytes, offset);
+    } else if (vpn < imagePages && executable != NULL) {
+        ReadSegment(&codeSeg, buffer, vpn, last);
+        ReadSegment(&dataSeg, buffer, vpn, last);
+    }
+
+    for (unsigned int i = vpn; i < last; i++) {
+        bcopy(&buffer[(i - vpn) * PageSize],
+              &(machine->mainMemory[pageTable[i].physicalPage * PageSize]),
+              PageSize);
+        pageTable[i].valid = TRUE;
+        pageTable[i].use = FALSE;
+        pageTable[i].dirty = FALSE;
+        pageTable[i].readOnly = FALSE;
+        pageTable[i].superPage = FALSE;
+        shared[i] = FALSE;
+    }
+    delete [] buffer;
+
+#ifdef USE_TLB
+    // see whether the cluster completed some superpage; only the TLB
+    // gains from one, and superpages are never merged
+    for (unsigned int first = vpn - vpn % SuperPagePages; first < last;
+            first += SuperPagePages)
+        PromoteSuperPage(first);
+#endif
+    return TRUE;
+}
 
-}
\ No newline at end of file
+//----------------------------------------------------------------------
+// AddrSpace::GrowStack
+// 	The stack starts out UserStackSize bytes long, with an unmapped
+//	guard page just below it.  A fault on the guard page, or up to
+//	StackGrowPages below the stack -- a frame bigger than a page
+//	skips over the guard -- grows the stack down to that page, and
+//	the page below becomes the new guard, until the stack is
+//	MaxStackPages long.  Any other fault below the stack is an
+//	overflow.
+//
+//	Returns TRUE if "vpn" is now part of the stack.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::GrowStack(unsigned int vpn)
+{
+    if (vpn + StackGrowPages < stackBottom || vpn <= imagePages)
+        return FALSE;
+
+    stackBottom = vpn;
+    DEBUG('a', "Stack grown to %d pages\n", heapBase - stackBottom);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReadSegment
+// 	Read the part of segment "seg" of the executable that falls in
+//	pages [firstPage, lastPage) into "buffer", which holds those
+//	pages.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReadSegment(Segment *seg, char *buffer, unsigned int firstPage,
+                       unsigned int lastPage)
+{
+    int start = max(seg->virtualAddr, (int) (firstPage * PageSize));
+    int end = min(seg->virtualAddr + seg->size, (int) (lastPage * PageSize));
+
+    if (start >= end)
+        return;
+    DEBUG('a', "Reading %d bytes of the program at 0x%x\n", end - start, start);
+    executable->ReadAt(&buffer[start - firstPage * PageSize], end - start,
+                       seg->inFileAddr + (start - seg->virtualAddr));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Sbrk
+// 	Move the end of the heap by "increment" bytes.  The heap starts
+//	just above the stack and may grow to MaxHeapPages pages; new
+//	pages are left invalid and zero-filled on first touch, and pages
+//	given back by a negative increment are freed right away.
+//
+//	Returns the old end of the heap, or -1 if it cannot move there.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Sbrk(int increment)
+{
+    unsigned int oldBreak = heapBreak;
+    int newBreak = (int) heapBreak + increment;
+
+    if (newBreak < (int) (heapBase * PageSize)
+            || newBreak > (int) ((heapBase + MaxHeapPages) * PageSize))
+        return -1;
+
+    unsigned int endPage = divRoundUp(newBreak, PageSize);
+    if (endPage > numPages)
+        GrowPageTable(endPage);
+
+    // free whatever the heap no longer covers; with mmLock held, so
+    // that a page on its way out to swap has got its slot by the time
+    // we look, and no stale slot is left to read back in if the heap
+    // grows again
+    mmLock->Acquire();
+    for (unsigned int vpn = endPage; vpn < divRoundUp(oldBreak, PageSize);
+            vpn++) {
+        if (swapSlot[vpn] >= 0) {
+            swapCache->Free(swapSlot[vpn]);
+            swapSlot[vpn] = NotSwapped;
+        }
+        if (!pageTable[vpn].valid)
+            continue;
+        DemoteSuperPage(vpn);
+        InvalidateTLB(vpn);
+        mm->DeallocatePage(pageTable[vpn].physicalPage);
+        pageTable[vpn].valid = FALSE;
+    }
+    mmLock->Release();
+
+    // keep the promise that memory handed out again reads as zero
+    if (increment < 0 && newBreak % PageSize != 0
+            && pageTable[newBreak / PageSize].valid
+            && (!shared[newBreak / PageSize]
+                || UnsharePage(newBreak / PageSize)))
+        bzero(&(machine->mainMemory[pageTable[newBreak / PageSize].physicalPage
+                * PageSize + newBreak % PageSize]),
+              PageSize - newBreak % PageSize);
+
+    heapBreak = newBreak;
+    DEBUG('a', "Heap break moved from 0x%x to 0x%x\n", oldBreak, heapBreak);
+    return oldBreak;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Mmap
+// 	Map the first "length" bytes of "file" (the whole file if
+//	"length" is 0 or more than its size) into this address space.
+//	A mapping never reaches past the end of the file, so writing
+//	to it cannot make the file grow.  The region is placed
+//	in the first hole above the heap big enough to hold it;
+//	none of its pages are loaded until they are touched.
+//
+//	Returns the virtual address of the mapping, or -1 on error.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Mmap(OpenFile *file, int length)
+{
+    int slot;
+
+    if (length == 0 || length > file->Length())
+        length = file->Length();
+    if (length <= 0)
+        return -1;
+
+    for (slot = 0; slot < MaxMmapRegions; slot++)
+        if (!mmapRegions[slot].inUse)
+            break;
+    if (slot == MaxMmapRegions)
+        return -1;
+
+    // first fit: slide past every region we would overlap
+    unsigned int pages = divRoundUp(length, PageSize);
+    unsigned int start = mmapBase;
+    bool moved = TRUE;
+    while (moved) {
+        moved = FALSE;
+        for (int i = 0; i < MaxMmapRegions; i++) {
+            MmapRegion *r = &mmapRegions[i];
+            if (r->inUse && start < r->startPage + r->numPages
+                    && r->startPage < start + pages) {
+                start = r->startPage + r->numPages;
+                moved = TRUE;
+            }
+        }
+    }
+    if (start + pages > numPages)
+        GrowPageTable(start + pages);
+
+    MmapRegion *region = &mmapRegions[slot];
+    region->file = file;
+    region->startPage = start;
+    region->numPages = pages;
+    region->length = length;
+    region->inUse = TRUE;
+    region->ownsFile = FALSE;
+
+    DEBUG('a', "Mapped %d bytes at page %d, %d pages\n", length, start, pages);
+    return start * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Munmap
+// 	Remove the mapping that starts at "virtAddr", writing its dirty
+//	pages back to the file and releasing its frames.
+//
+//	Returns 0 on success, -1 if no mapping starts there.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Munmap(int virtAddr)
+{
+    if (virtAddr < 0 || virtAddr % PageSize != 0)
+        return -1;
+
+    MmapRegion *region = FindRegion(virtAddr / PageSize);
+    if (region == NULL || region->startPage * PageSize != (unsigned) virtAddr)
+        return -1;
+
+    ReleaseRegion(region);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnmapAll
+// 	Remove every mapping, e.g. when the process exits.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::UnmapAll()
+{
+    for (int i = 0; i < MaxMmapRegions; i++)
+        if (mmapRegions[i].inUse)
+            ReleaseRegion(&mmapRegions[i]);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsMapped / AdoptFile
+// 	A mapped file can be closed by the program; the mapping then
+//	takes over the OpenFile and deletes it when it goes away.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsMapped(OpenFile *file)
+{
+    for (int i = 0; i < MaxMmapRegions; i++)
+        if (mmapRegions[i].inUse && mmapRegions[i].file == file)
+            return TRUE;
+    return FALSE;
+}
+
+void
+AddrSpace::AdoptFile(OpenFile *file)
+{
+    for (int i = 0; i < MaxMmapRegions; i++)
+        if (mmapRegions[i].inUse && mmapRegions[i].file == file) {
+            mmapRegions[i].ownsFile = TRUE;
+            return;			// one owner is enough
+        }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GrowPageTable
+// 	Extend the page table to "newNumPages" entries.  The new entries
+//	are invalid until something is mapped there.
+//
+//	The tables are swapped under mmLock, so that a page out of one of
+//	our pages, which holds it throughout, never writes to the old ones.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::GrowPageTable(unsigned int newNumPages)
+{
+    TranslationEntry *newTable = new TranslationEntry[newNumPages];
+    bool *newShared = new bool[newNumPages];
+    int *newSwapSlot = new int[newNumPages];
+    unsigned int i;
+
+    mmLock->Acquire();
+    for (i = 0; i < numPages; i++) {
+        newTable[i] = pageTable[i];
+        newShared[i] = shared[i];
+        newSwapSlot[i] = swapSlot[i];
+    }
+    for (; i < newNumPages; i++) {
+        newShared[i] = FALSE;
+        newSwapSlot[i] = NotSwapped;
+        newTable[i].virtualPage = i;
+        newTable[i].physicalPage = 0;
+        newTable[i].valid = FALSE;
+        newTable[i].use = FALSE;
+        newTable[i].dirty = FALSE;
+        newTable[i].readOnly = FALSE;
+        newTable[i].superPage = FALSE;
+    }
+    delete [] pageTable;
+    delete [] shared;
+    delete [] swapSlot;
+    pageTable = newTable;
+    shared = newShared;
+    swapSlot = newSwapSlot;
+    numPages = newNumPages;
+    mmLock->Release();
+
+    if (currentThread->space == this)	// the machine still points at
+        RestoreState();			// the old table
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindRegion
+// 	Return the mapping that covers virtual page "vpn", or NULL.
+//----------------------------------------------------------------------
+
+MmapRegion *
+AddrSpace::FindRegion(unsigned int vpn)
+{
+    for (int i = 0; i < MaxMmapRegions; i++) {
+        MmapRegion *r = &mmapRegions[i];
+        if (r->inUse && vpn >= r->startPage && vpn < r->startPage + r->numPages)
+            return r;
+    }
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WriteBackPage
+// 	Write a resident, dirty page of a mapping back to its file.
+//	Only the bytes that are actually part of the mapping are written,
+//	so the file never grows past the mapped length.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::WriteBackPage(MmapRegion *region, unsigned int vpn)
+{
+    if (region->file == NULL || !pageTable[vpn].valid)
+        return;
+    InvalidateTLB(vpn);			// fetch the dirty bit
+    if (!pageTable[vpn].dirty)
+        return;
+
+    int offset = (vpn - region->startPage) * PageSize;
+    int bytes = min(PageSize, region->length - offset);
+    if (bytes > 0)
+        region->file->WriteAt(
+                &(machine->mainMemory[pageTable[vpn].physicalPage * PageSize]),
+                bytes, offset);
+    pageTable[vpn].dirty = FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleaseRegion
+// 	Write back and unmap every page of "region", and free its slot.
+//	If the file was closed while mapped, it is deleted here -- unless
+//	another mapping of the same file still needs it.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReleaseRegion(MmapRegion *region)
+{
+    for (unsigned int vpn = region->startPage;
+            vpn < region->startPage + region->numPages; vpn++) {
+        if (!pageTable[vpn].valid)
+            continue;
+        WriteBackPage(region, vpn);
+        InvalidateTLB(vpn);
+        mmLock->Acquire();
+        mm->DeallocatePage(pageTable[vpn].physicalPage);
+        mmLock->Release();
+        pageTable[vpn].valid = FALSE;
+    }
+
+    region->inUse = FALSE;
+    if (region->ownsFile) {
+        if (IsMapped(region->file))
+            AdoptFile(region->file);
+        else
+            delete region->file;
+    }
+    region->file = NULL;
+    region->ownsFile = FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsMergeable
+// 	The page merger may share any resident page, except pages of
+//	mapped files, which must be written back from their own frame,
+//	pages that are read-only for some other reason, and pages of a
+//	superpage, which is worth more whole than one frame saved.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsMergeable(unsigned int vpn)
+{
+    return pageTable[vpn].valid && !pageTable[vpn].superPage
+        && (!pageTable[vpn].readOnly || shared[vpn])
+        && FindRegion(vpn) == NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SharePage
+// 	Point page "vpn" at "frame", which holds the same bytes as the
+//	page's own frame, and write-protect it so that the first write
+//	makes a private copy.  The old frame loses a reference, and is
+//	freed once no page maps it.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SharePage(unsigned int vpn, int frame)
+{
+    int old = pageTable[vpn].physicalPage;
+
+    DemoteSuperPage(vpn);
+    InvalidateTLB(vpn);
+    if (old != frame) {
+        mm->ShareFrame(frame);
+        pageTable[vpn].physicalPage = frame;
+        mm->DeallocatePage(old);
+    }
+    pageTable[vpn].readOnly = TRUE;
+    shared[vpn] = TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnsharePage
+// 	Make page "vpn" writable again, after a write to it trapped with
+//	a ReadOnlyException.  If other pages still map its frame, copy it
+//	into a frame of its own first.
+//
+//	Returns FALSE if the page was not shared, or there is no free
+//	frame for the copy; the caller should then kill the process.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::UnsharePage(unsigned int vpn)
+{
+    if (vpn >= numPages || !pageTable[vpn].valid || !shared[vpn])
+        return FALSE;
+
+    DemoteSuperPage(vpn);
+    InvalidateTLB(vpn);
+    int old = pageTable[vpn].physicalPage;
+    if (mm->GetRefCount(old) > 1) {
+        mmLock->Acquire();
+        int frame = AllocateFrame(vpn);
+        if (frame != -1) {
+            bcopy(&(machine->mainMemory[old * PageSize]),
+                  &(machine->mainMemory[frame * PageSize]), PageSize);
+            pageTable[vpn].physicalPage = frame;
+            mm->DeallocatePage(old);
+        }
+        mmLock->Release();
+        if (frame == -1)
+            return FALSE;
+        stats->numPagesUnmerged++;
+        DEBUG('a', "Copied shared page %d into frame %d\n", vpn, frame);
+    }
+    pageTable[vpn].readOnly = FALSE;
+    shared[vpn] = FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateFrame
+// 	Find a frame for page "vpn": a free one if there is any, else one
+//	freed by merging identical pages, else one freed by paging some
+//	page out.  Call with mmLock held.
+//
+//	Returns the frame, or -1 if memory is full of pages that cannot
+//	be paged out.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AllocateFrame(unsigned int vpn)
+{
+    int frame = mm->AllocatePage();
+
+    if (frame == -1) {
+        pageMerger->Scan();
+        frame = mm->AllocatePage();
+    }
+    if (frame == -1 && mm->EvictPage() != -1)
+        frame = mm->AllocatePage();
+    if (frame != -1)
+        mm->SetOwner(frame, this, vpn);
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsEvictable
+// 	Page "vpn" may be paged out if it is resident in "frame", has the
+//	frame to itself, and is not a page of a mapped file, which must
+//	only ever be written back to its own file.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsEvictable(unsigned int vpn, int frame)
+{
+    return vpn < numPages && pageTable[vpn].valid
+        && pageTable[vpn].physicalPage == (unsigned) frame && !shared[vpn]
+        && FindRegion(vpn) == NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageOut
+// 	Move page "vpn" into the swap cache and free its frame.  The page
+//	is marked invalid first, so that a fault on it while the page is
+//	on its way out waits for mmLock, held by our caller.
+//
+//	Returns FALSE if the swap cache is full.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::PageOut(unsigned int vpn)
+{
+    int frame = pageTable[vpn].physicalPage;
+
+    DemoteSuperPage(vpn);
+    InvalidateTLB(vpn);
+    pageTable[vpn].valid = FALSE;
+    swapSlot[vpn] = SwapPending;
+    int handle = swapCache->Store(&(machine->mainMemory[frame * PageSize]));
+    if (handle == -1) {
+        pageTable[vpn].valid = TRUE;
+        swapSlot[vpn] = NotSwapped;
+        return FALSE;
+    }
+    swapSlot[vpn] = handle;
+    mm->DeallocatePage(frame);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SwapIn
+// 	Bring page "vpn" back from the swap cache.
+//
+//	Returns FALSE if there is no frame for it.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::SwapIn(unsigned int vpn)
+{
+    mmLock->Acquire();
+    if (pageTable[vpn].valid) {		// paging it out failed after all
+        mmLock->Release();
+        return TRUE;
+    }
+
+    int frame = AllocateFrame(vpn);
+    if (frame == -1) {
+        mmLock->Release();
+        return FALSE;
+    }
+    DEBUG('a', "Page fault on page %d, swapping it into frame %d\n",
+            vpn, frame);
+    stats->numPageFaults++;
+    swapCache->Load(swapSlot[vpn], &(machine->mainMemory[frame * PageSize]));
+    swapSlot[vpn] = NotSwapped;
+
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].valid = TRUE;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].dirty = FALSE;
+    pageTable[vpn].readOnly = FALSE;
+    pageTable[vpn].superPage = FALSE;
+    shared[vpn] = FALSE;
+    mmLock->Release();
+    return TRUE;
+}
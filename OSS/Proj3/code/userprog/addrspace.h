@@ -16,16 +16,43 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "pcb.h"
+#include "noff.h"
 
 class PCB;
 
-#define UserStackSize		1024 	// increase this as necessary!
+#define UserStackSize		256 	// stack a process starts out with
+#define MaxStackPages		32	// most the stack may grow to; one
+					// more page below it stays a guard
+#define StackGrowPages		8	// how far below the stack a fault
+					// may be and still grow it
+#define MaxMmapRegions		8	// files mapped at once by one process
+#define MaxHeapPages		NumPhysPages	// virtual pages reserved
+					// above the stack for Sbrk
+#define MaxClusterPages		8	// most pages read in on one fault
+
+#define NotSwapped		-1	// swapSlot of a page that is not out
+#define SwapPending		-2	// swapSlot while it is being paged out
+
+// A file mapped into an address space by the Mmap system call.
+// Its pages start out invalid and are read in from "file" when first
+// touched; dirty pages are written back on Munmap or exit.
+
+class MmapRegion {
+  public:
+    OpenFile *file;		// backing file, NULL for an anonymous copy
+    unsigned int startPage;	// first virtual page of the mapping
+    unsigned int numPages;	// number of pages in the mapping
+    int length;			// number of bytes of the file mapped
+    bool inUse;			// is this slot holding a mapping
+    bool ownsFile;		// the file was closed while mapped, so we
+				// must delete it when the mapping goes away
+};
 
 class AddrSpace {
   public:
-    AddrSpace(OpenFile *executable, PCB *temppcb=NULL);	// Create an address space,
+    AddrSpace(OpenFile *programFile, PCB *temppcb=NULL); // Create an address space,
 					// initializing it with the program
-					// stored in the file "executable"
+					// stored in the file "programFile"
     AddrSpace(AddrSpace* space, PCB *temppcb=NULL); // Create an address space,
           // which is a copy of an existing one
     ~AddrSpace();			// De-allocate an address space
@@ -35,10 +62,37 @@ class AddrSpace {
 
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch
-    void getString(char *str, int virtAd);
+    bool getString(char *str, int virtAd); // FALSE if not all mapped
     unsigned int GetNumPages(); // get size of addr space
     TranslationEntry* GetPageTable(); // return pageTable
-    unsigned int Translate(unsigned int virtualAddr);
+    int Translate(unsigned int virtualAddr); // -1 if not mapped
+    bool FaultIn(int virtAddr, int size, bool writing = FALSE);
+					// make a user buffer resident (and
+					// private, if the kernel writes it)
+    bool HandlePageFault(int virtAddr);	// bring in the page holding
+					// virtAddr; FALSE if it is not mapped
+    bool LoadTLB(int virtAddr);		// TLB miss: load the translation
+					// of virtAddr, paging it in first
+    static void SyncTLB();		// copy TLB use/dirty bits back to
+					// the page tables
+
+    bool IsMergeable(unsigned int vpn);	// may the page merger share vpn
+    void SharePage(unsigned int vpn, int frame); // map vpn copy-on-write
+					// onto "frame", which holds the
+					// same bytes
+    bool UnsharePage(unsigned int vpn);	// give vpn a private copy again
+
+    bool IsEvictable(unsigned int vpn, int frame); // may vpn, in "frame",
+					// be paged out
+    bool PageOut(unsigned int vpn);	// move vpn to the swap cache
+
+    int Sbrk(int increment);		// move the heap break, return the
+					// old break or -1
+    int Mmap(OpenFile *file, int length); // map a file, return its address
+    int Munmap(int virtAddr);		// unmap the region at virtAddr
+    void UnmapAll();			// write back and drop all mappings
+    bool IsMapped(OpenFile *file);	// is "file" backing some mapping
+    void AdoptFile(OpenFile *file);	// the mapping now owns "file"
     PCB* pcb; // the process that owns this addresspace
     bool valid; // is AddrSpace valid
 
@@ -46,8 +100,51 @@ class AddrSpace {
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
+    bool *shared;			// per page: read-only only because
+					// the page merger shares its frame
+    int *swapSlot;			// per page: its SwapCache handle
+					// while paged out, or NotSwapped
     unsigned int numPages;		// Number of pages in the virtual
 					// address space
+    unsigned int imagePages;		// pages of code, data and bss
+    unsigned int stackTop;		// address just past the user stack
+    unsigned int stackBottom;		// lowest page of the stack; the
+					// one below it is the guard page
+    unsigned int heapBase;		// first page of the heap
+    unsigned int heapBreak;		// address just past the heap
+    unsigned int mmapBase;		// first page available for mappings
+    MmapRegion mmapRegions[MaxMmapRegions];
+
+    OpenFile *executable;		// program file, to page the code
+					// and data in from; NULL in a child
+    Segment codeSeg, dataSeg;		// where they are in "executable"
+
+    unsigned int lastFaultEnd;		// page just past the last cluster
+    unsigned int clusterSize;		// pages to read on the next fault
+
+    int asid;				// tags our entries in the TLB
+    int asidGeneration;			// ... valid while this matches the
+					// current ASID generation
+
+    void GrowPageTable(unsigned int newNumPages);
+    bool GrowStack(unsigned int vpn);	// fault just below the stack
+    int AllocateFrame(unsigned int vpn); // a frame for vpn, paging
+					// something out if need be
+    bool SwapIn(unsigned int vpn);	// fault on a paged out page
+    void ReadSegment(Segment *seg, char *buffer, unsigned int firstPage,
+                     unsigned int lastPage); // page in part of the image
+    MmapRegion *FindRegion(unsigned int vpn);
+    void WriteBackPage(MmapRegion *region, unsigned int vpn);
+    void ReleaseRegion(MmapRegion *region);
+    void AssignAsid();			// get an ASID if ours is stale
+    void InvalidateTLB(unsigned int vpn); // drop vpn from the TLB, after
+					// its page table entry changed
+    void MergeTLBBits(TranslationEntry *entry); // fold the use/dirty
+					// bits of a TLB entry into ours
+    void PromoteSuperPage(unsigned int first); // make the run of pages
+					// at "first" a superpage, if we can
+    void DemoteSuperPage(unsigned int vpn); // split the superpage
+					// holding vpn back into pages
 };
 
 #endif // ADDRSPACE_H
@@ -8,6 +8,7 @@
 
 #include "copyright.h"
 #include "bitmap.h"
+#include "objcache.h"
 
 //----------------------------------------------------------------------
 // BitMap::BitMap
@@ -21,7 +22,11 @@ BitMap::BitMap(int nitems)
 { 
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
-    map = new unsigned int[numWords];
+    // there are only a few sizes of bitmap; the free sector map, for
+    // one, is read in again by every file system call that changes it
+    mapCache = ObjectCache::ForSize("BitMap words",
+					numWords * sizeof(unsigned int));
+    map = (unsigned int *) mapCache->Alloc();
     for (int i = 0; i < numBits; i++) 
         Clear(i);
 }
@@ -33,7 +38,7 @@ BitMap::BitMap(int nitems)
 
 BitMap::~BitMap()
 { 
-    delete map;
+    mapCache->Free(map);
 }
 
 //----------------------------------------------------------------------
@@ -17,6 +17,7 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "objcache.h"
 #include "openfile.h"
 
 // Definitions helpful for representing a bitmap as an array of integers
@@ -36,6 +37,7 @@ class BitMap {
     BitMap(int nitems);		// Initialize a bitmap, with "nitems" bits
 				// initially, all bits are cleared.
     ~BitMap();			// De-allocate bitmap
+    CACHED_OBJECTS(BitMap)
     
     void Mark(int which);   	// Set the "nth" bit
     void Clear(int which);  	// Clear the "nth" bit
@@ -59,6 +61,7 @@ class BitMap {
 					//  multiple of the number of bits in
 					//  a word)
     unsigned int *map;			// bit storage
+    ObjectCache *mapCache;		// where "map" came from
 };
 
 #endif // BITMAP_H
@@ -27,6 +27,42 @@
 #include "list.h"
 #include "filesys.h"
 #include "openfile.h"
+#include "objcache.h"
+
+// File names, and the data system calls copy in and out of user
+// memory, go through kernel buffers.  Most are small, so they come
+// from a cache; only reads and writes of more than SyscallBufferSize
+// bytes get a buffer from the heap.
+
+#define SyscallBufferSize 256
+
+static ObjectCache bufferCache("Syscall buffer", SyscallBufferSize);
+
+char* allocBuffer(int size) {
+    if (size <= SyscallBufferSize)
+        return (char*) bufferCache.Alloc();
+    return new char[size];
+}
+
+void freeBuffer(char* buffer, int size) {
+    if (size <= SyscallBufferSize)
+        bufferCache.Free(buffer);
+    else
+        delete[] buffer;
+}
+
+// Copy a value to or from user memory.  With a TLB the access may miss;
+// the miss is handled, so try once more, but only once: any other
+// failure is a fault, and the system call fails.
+bool writeUser(int addr, int size, int value) {
+    return machine->WriteMem(addr, size, value)
+        || machine->WriteMem(addr, size, value);
+}
+
+bool readUser(int addr, int size, int* value) {
+    return machine->ReadMem(addr, size, value)
+        || machine->ReadMem(addr, size, value);
+}
 
 //----------------------------------------------------------------------
 // ExceptionHandler
@@ -51,24 +87,45 @@
 //	are in machine.h.
 //----------------------------------------------------------------------
 
+// The end of exiting, once the address space is gone: close the files
+// of process "pcb", and hand "status" to its parent.  The parent may
+// free the PCB as soon as it is woken, so that comes last.
+void exitProcess(PCB* pcb, int status) {
+    // Close all open files and cleanup as previously discussed
+    for (int i = 2; i < MAX_OPEN_FILES; i++) {
+        if (pcb->GetOpenFile(i) != NULL) {
+            pcb->CloseOpenFile(i);
+        }
+    }
+
+    pcb->DeleteExitedChildrenSetParentNull();
+
+    pcb->exitStatus = status;
+
+    // Wake our parent, if it is waiting in Join
+    if (pcb->parent != NULL)
+        pcb->parent->ChildExited();
+
+    currentThread->Finish();
+}
+
 void doExit(int status) {
     int pid = currentThread->space->pcb->pid;
     printf("System Call: [%d] invoked Exit.\n", pid);
     printf("Process [%d] exits with [%d]\n", pid, status);
 
-    currentThread->space->pcb->exitStatus = status;
+    PCB* pcb = currentThread->space->pcb;
 
-    // Close all open files and cleanup as previously discussed
-    for (int i = 2; i < MAX_OPEN_FILES; i++) {
-        if (currentThread->space->pcb->GetOpenFile(i) != NULL) {
-            currentThread->space->pcb->CloseOpenFile(i);
-        }
-    }
+    // Write back mapped files while their OpenFiles are still around
+    currentThread->space->UnmapAll();
 
-    currentThread->space->pcb->DeleteExitedChildrenSetParentNull();
+    // Once the address space is gone, the scheduler must not save or
+    // restore it when we switch away
+    AddrSpace* space = currentThread->space;
+    currentThread->space = NULL;
+    delete space;
 
-    delete currentThread->space;
-    currentThread->Finish();
+    exitProcess(pcb, status);
 }
 
 
@@ -105,23 +162,27 @@ int doFork(int functionAddr) {
     int pid = currentThread->space->pcb->pid;
     printf("System Call: [%d] invoked Fork.\n", pid);
 
-    // 1. Check if sufficient memory exists to create new process
-    unsigned int n = currentThread->space->GetNumPages();
-    if (n > mm->GetFreePageCount()) {
-        int potentialChildPid = pcbManager->GetNextFreePid();
-        printf("Not Enough Memory for Child Process %d\n", potentialChildPid);
-        return -1;
-    }
+    // 1. Whether there is enough memory for the new process is checked
+    // when its address space is copied: only the resident pages count,
+    // since the rest of the (sparse) address space is paged in lazily
 
     // 2. SaveUserState for the parent thread
     currentThread->SaveUserState();
 
     // 3. Create a new address space for child by copying parent address space
     AddrSpace* childAddrSpace = new AddrSpace(currentThread->space);
+    if (!childAddrSpace->valid) {
+        int potentialChildPid = pcbManager->GetNextFreePid();
+        printf("Not Enough Memory for Child Process %d\n", potentialChildPid);
+        delete childAddrSpace;
+        currentThread->RestoreUserState();
+        return -1;
+    }
 
     // 4. Create a new thread for the child and set its addrSpace
     Thread* childThread = new Thread("childThread");
     childThread->space = childAddrSpace;
+    childThread->setPriority(currentThread->getBasePriority());
 
     // 5. Create a PCB for the child and connect it all up
     PCB* pcb = pcbManager->AllocatePCB();
@@ -170,16 +231,23 @@ int doExec(char* filename) {
     PCB* temp_pcb = currentThread->space->pcb;
     temp_pcb->thread = currentThread;
 
-    // 6. Delete current address space
-    delete currentThread->space;
+    // 6. Delete current address space.  It goes before the new one is
+    // made, so that its frames are free when the new one waits for
+    // room; meanwhile the scheduler must not save or restore it
+    space = currentThread->space;
+    currentThread->space = NULL;
+    delete space;
 
     // 2. Create new address space
     space = new AddrSpace(executable, temp_pcb);
 
-    // 3. Check if Addrspace creation was successful
+    // 3. Check if Addrspace creation was successful.  The old program
+    // is gone, so there is nothing to return to: the process exits
     if (space->valid != true) {
         printf("Could not create AddrSpace\n");
-        return -1;
+        delete space;
+        freeBuffer(filename, SyscallBufferSize);
+        exitProcess(temp_pcb, -1);
     }
 
     // Steps 4 and 5 may not be necessary!!
@@ -189,8 +257,8 @@ int doExec(char* filename) {
     // 7. Set the addrspace for currentThread
     currentThread->space = space;
 
-    // 8. delete executable; // close file
-    delete executable;
+    // 8. The address space closes the executable when it goes away;
+    // until then the program is paged in from it
 
     // 9. Initialize registers for new addrspace
     currentThread->space->InitRegisters(); // set the initial register values
@@ -199,7 +267,9 @@ int doExec(char* filename) {
     currentThread->space->RestoreState(); // load page table register
     printf("Exec Program: [%d] loading [%s]\n", pid, filename);
 
-    // 11. Run the machine now that all is set up
+    // 11. Run the machine now that all is set up; we never come back
+    // to free the name the handler read in for us, so do it here
+    freeBuffer(filename, SyscallBufferSize);
     machine->Run(); // jump to the user program
     ASSERT(FALSE); // Execution never reaches here
 
@@ -217,14 +287,15 @@ int doJoin(int pid) {
     PCB* pcb = currentThread->space->pcb;
     if (joinPCB->parent != pcb) return -1;
 
-    // 3. Yield until joinPCB has exited
-    while (!joinPCB->HasExited()) {
-        printf("System Call: [%d] invoked Yield while waiting for child [%d].\n", currentThread->space->pcb->pid, pid);
-        currentThread->Yield();
-    }
+    // 3. Sleep until joinPCB has exited; a child that is killed is
+    // taken off our list of children instead
+    while (pcb->HasChild(joinPCB) && !joinPCB->HasExited())
+        pcb->WaitForChild();
+    if (!pcb->HasChild(joinPCB)) return -1;
 
     // 4. Store status and delete joinPCB
     int status = joinPCB->exitStatus;
+    pcb->RemoveChild(joinPCB);
     pcbManager->DeallocatePCB(joinPCB);
 
     // 5. Return status
@@ -232,6 +303,38 @@ int doJoin(int pid) {
     return status;
 }
 
+int doJoinAny(int statusAddr) {
+    PCB* pcb = currentThread->space->pcb;
+    PCB* child;
+
+    printf("System Call: [%d] invoked JoinAny.\n", pcb->pid);
+
+    // 1. Sleep until one of our children has exited
+    while ((child = pcb->ExitedChild()) == NULL) {
+        if (!pcb->HasChildren()) return -1;
+        pcb->WaitForChild();
+    }
+
+    // 2. Check that the caller can be given the status, if it asked
+    // for it, while the child can still be left for another JoinAny
+    if (statusAddr != 0
+            && !currentThread->space->FaultIn(statusAddr, sizeof(int), TRUE))
+        return -1;
+
+    // 3. Store status and delete the child
+    int pid = child->pid;
+    int status = child->exitStatus;
+    pcb->RemoveChild(child);
+    pcbManager->DeallocatePCB(child);
+
+    // 4. Give the caller the status
+    if (statusAddr != 0)
+        writeUser(statusAddr, sizeof(int), status);
+
+    printf("Process [%d] successfully joined with child process [%d], exit status [%d]\n", pcb->pid, pid, status);
+    return pid;
+}
+
 int doKill(int pid) {
     // 1. Check if the pid is valid and if not, return -1
     PCB* targetPCB = pcbManager->GetPCB(pid);
@@ -260,9 +363,22 @@ int doKill(int pid) {
     // Set exit status to indicate process was killed
     targetPCB->exitStatus = -1;
 
+    // The PCB goes away now, so take it off its parent's list of
+    // children, and wake the parent if it is waiting to join it
+    if (targetPCB->parent != NULL) {
+        targetPCB->parent->RemoveChild(targetPCB);
+        targetPCB->parent->ChildExited();
+    }
+
     // Clean up children processes
     targetPCB->DeleteExitedChildrenSetParentNull();
 
+    // Take the target off the ready list, or whatever queue it sleeps
+    // on, before anything goes away: in Join it sleeps on its own PCB
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    targetThread->Unqueue();
+    (void) interrupt->SetLevel(oldLevel);
+
     // Deallocate the PCB and release the PID
     pcbManager->DeallocatePCB(targetPCB);
 
@@ -272,10 +388,8 @@ int doKill(int pid) {
         targetThread->space = NULL;
     }
 
-    // Mark the target thread for termination
     printf("System Call: [%d] invoked Kill.\n", currentThread->space->pcb->pid);
     printf("Process [%d] killed process [%d]\n", currentThread->space->pcb->pid, pid);
-    scheduler->RemoveThread(targetThread);
 
     // 5. Return 0 for success
     return 0;
@@ -288,17 +402,44 @@ void doYield() {
     currentThread->Yield();
 }
 
+void doSetPriority() {
+    int priority = machine->ReadRegister(4);
+
+    printf("System Call: [%d] invoked SetPriority.\n", currentThread->space->pcb->pid);
+
+    if (priority < 0 || priority >= NumPriorities) {
+        machine->WriteRegister(2, -1);
+        return;
+    }
+    machine->WriteRegister(2, currentThread->getBasePriority());
+    currentThread->setPriority(priority);
+
+    // we may no longer be the most urgent thread around
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    scheduler->Preempt();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+// Returns NULL if the string runs into an address that is not mapped.
 char* readString(int virtualAddr) {
     int i = 0;
-    char* str = new char[256];
-    unsigned int physicalAddr = currentThread->space->Translate(virtualAddr);
+    char* str = allocBuffer(SyscallBufferSize);
+    int physicalAddr = currentThread->space->Translate(virtualAddr);
 
     // Need to get one byte at a time since the string may straddle multiple pages that are not guaranteed to be contiguous in the physicalAddr space
+    if (physicalAddr == -1) {
+        freeBuffer(str, SyscallBufferSize);
+        return NULL;
+    }
     bcopy(&(machine->mainMemory[physicalAddr]), &str[i], 1);
     while (str[i] != '\0' && i != 256 - 1) {
         virtualAddr++;
         i++;
         physicalAddr = currentThread->space->Translate(virtualAddr);
+        if (physicalAddr == -1) {
+            freeBuffer(str, SyscallBufferSize);
+            return NULL;
+        }
         bcopy(&(machine->mainMemory[physicalAddr]), &str[i], 1);
     }
     if (i == 256 - 1 && str[i] != '\0') {
@@ -311,21 +452,30 @@ char* readString(int virtualAddr) {
 void doCreate() {
     printf("Syscall Call: [%d] invoked Create.\n", currentThread->space->pcb->pid);
     int virtAddr = machine->ReadRegister(4);
-    char *fileName = new char [256];
-    currentThread->space->getString(fileName, virtAddr);
+    char *fileName = allocBuffer(SyscallBufferSize);
+    if (!currentThread->space->getString(fileName, virtAddr)) {
+        machine->WriteRegister(2, -1);
+        freeBuffer(fileName, SyscallBufferSize);
+        return;
+    }
     bool success = fileSystem->Create(fileName, 1000);
     machine->WriteRegister(2, success ? 0 : -1);
-    delete[] fileName;
+    freeBuffer(fileName, SyscallBufferSize);
     return;
 }
 
 void doOpen() {
     int virtAddr = machine->ReadRegister(4);
     char fileName[256];
-    currentThread->space->getString(fileName, virtAddr);
+    bool mapped = currentThread->space->getString(fileName, virtAddr);
 
     printf("Syscall Call: [%d] invoked Open.\n", currentThread->space->pcb->pid);
 
+    if (!mapped) {
+        machine->WriteRegister(2, -1);
+        return;
+    }
+
     OpenFile* openFile = fileSystem->Open(fileName);
     if (openFile == NULL) {
         machine->WriteRegister(2, -1); // Failed to open file
@@ -355,10 +505,17 @@ void doRead() {
         return;
     }
 
-    char* buffer = new char[size];
+    if (!currentThread->space->FaultIn(bufferAddr, size)) {
+        machine->WriteRegister(2, -1);
+        return;
+    }
+
+    int bufferSize = size;
+    char* buffer = allocBuffer(bufferSize);
 
     if (fileId == ConsoleInput) {
-        // Read from console
+        // Read from console; waiting for the user marks us interactive
+        scheduler->IOWait();
         int i;
         for (i = 0; i < size; i++) {
             int c = getchar();
@@ -376,7 +533,7 @@ void doRead() {
         OpenFile* openFile = currentThread->space->pcb->GetOpenFile(fileId);
         if (openFile == NULL) {
             machine->WriteRegister(2, -1);
-            delete[] buffer;
+            freeBuffer(buffer, bufferSize);
             return;
         }
         int bytesRead = openFile->Read(buffer, size);
@@ -384,12 +541,21 @@ void doRead() {
         size = bytesRead;
     }
 
-    // Copy buffer to user memory
+    // Copy buffer to user memory; the read may have blocked, so make
+    // sure no page of the buffer got shared with another in the meantime
+    if (!currentThread->space->FaultIn(bufferAddr, size, TRUE)) {
+        machine->WriteRegister(2, -1);
+        freeBuffer(buffer, bufferSize);
+        return;
+    }
     for (int i = 0; i < size; i++) {
-        machine->WriteMem(bufferAddr + i, 1, buffer[i]);
+        if (!writeUser(bufferAddr + i, 1, buffer[i])) {
+            machine->WriteRegister(2, -1);
+            break;
+        }
     }
 
-    delete[] buffer;
+    freeBuffer(buffer, bufferSize);
 }
 
 void doWrite() {
@@ -404,10 +570,19 @@ void doWrite() {
         return;
     }
 
-    char* buffer = new char[size];
+    if (!currentThread->space->FaultIn(bufferAddr, size)) {
+        machine->WriteRegister(2, -1);
+        return;
+    }
+
+    char* buffer = allocBuffer(size);
     for (int i = 0; i < size; i++) {
         int temp;
-        machine->ReadMem(bufferAddr + i, 1, &temp);
+        if (!readUser(bufferAddr + i, 1, &temp)) {
+            machine->WriteRegister(2, -1);
+            freeBuffer(buffer, size);
+            return;
+        }
         buffer[i] = (char)temp;
     }
 
@@ -423,14 +598,14 @@ void doWrite() {
         if (openFile == NULL) {
             machine->WriteRegister(2, -1);
             printf("\n");
-            delete[] buffer;
+            freeBuffer(buffer, size);
             return;
         }
         int bytesWritten = openFile->Write(buffer, size);
         machine->WriteRegister(2, bytesWritten);
     }
 
-    delete[] buffer;
+    freeBuffer(buffer, size);
     return;
 }
 
@@ -446,6 +621,16 @@ void doClose() {
         return;
     }
 
+    // A mapped file stays open until it is unmapped; the mapping
+    // takes it over and only the descriptor goes away here
+    OpenFile* openFile = currentThread->space->pcb->GetOpenFile(fileId);
+    if (openFile != NULL && currentThread->space->IsMapped(openFile)) {
+        currentThread->space->AdoptFile(openFile);
+        currentThread->space->pcb->DetachOpenFile(fileId);
+        machine->WriteRegister(2, 0);
+        return;
+    }
+
     bool result = currentThread->space->pcb->CloseOpenFile(fileId);
     if (!result) {
         machine->WriteRegister(2, -1); // Failed
@@ -455,6 +640,59 @@ void doClose() {
 }
 
 
+void doSbrk() {
+    int increment = machine->ReadRegister(4);
+
+    printf("System Call: [%d] invoked Sbrk.\n", currentThread->space->pcb->pid);
+
+    machine->WriteRegister(2, currentThread->space->Sbrk(increment));
+}
+
+void doMmap() {
+    int fileId = machine->ReadRegister(4);
+    int length = machine->ReadRegister(5);
+
+    printf("System Call: [%d] invoked Mmap.\n", currentThread->space->pcb->pid);
+
+    OpenFile* openFile = currentThread->space->pcb->GetOpenFile(fileId);
+    if (openFile == NULL || fileId == ConsoleInput || fileId == ConsoleOutput
+            || length < 0) {
+        machine->WriteRegister(2, -1);
+        return;
+    }
+
+    int addr = currentThread->space->Mmap(openFile, length);
+    if (addr != -1)
+        printf("Process [%d] mapped file [%d] at address [0x%x]\n",
+               currentThread->space->pcb->pid, fileId, addr);
+    machine->WriteRegister(2, addr);
+}
+
+void doMunmap() {
+    int addr = machine->ReadRegister(4);
+
+    printf("System Call: [%d] invoked Munmap.\n", currentThread->space->pcb->pid);
+
+    machine->WriteRegister(2, currentThread->space->Munmap(addr));
+}
+
+void doReadOnlyFault(int badVAddr) {
+    if (currentThread->space->UnsharePage(badVAddr / PageSize))
+        return;			// re-execute the faulting instruction
+
+    int pid = currentThread->space->pcb->pid;
+    printf("Process [%d] wrote to read-only address [0x%x]\n", pid, badVAddr);
+    doExit(-1);
+}
+
+void doPageFault(int badVAddr) {
+    if (currentThread->space->LoadTLB(badVAddr))
+        return;			// re-execute the faulting instruction
+
+    int pid = currentThread->space->pcb->pid;
+    printf("Process [%d] faulted on unmapped address [0x%x]\n", pid, badVAddr);
+    doExit(-1);
+}
 
 
 
@@ -476,13 +714,21 @@ ExceptionHandler(ExceptionType which)
     } else if ((which == SyscallException) && (type == SC_Exec)) {
         int virtAddr = machine->ReadRegister(4);
         char* fileName = readString(virtAddr);
-        int ret = doExec(fileName);
+        int ret = -1;
+        if (fileName != NULL) {
+            ret = doExec(fileName);     // returns only if it failed
+            freeBuffer(fileName, SyscallBufferSize);
+        }
         machine->WriteRegister(2, ret);
         incrementPC();
     } else if ((which == SyscallException) && (type == SC_Join)) {
         int ret = doJoin(machine->ReadRegister(4));
         machine->WriteRegister(2, ret);
         incrementPC();
+    } else if ((which == SyscallException) && (type == SC_JoinAny)) {
+        int ret = doJoinAny(machine->ReadRegister(4));
+        machine->WriteRegister(2, ret);
+        incrementPC();
     } else if ((which == SyscallException) && (type == SC_Kill)) {
         int ret = doKill(machine->ReadRegister(4));
         machine->WriteRegister(2, ret);
@@ -505,6 +751,22 @@ ExceptionHandler(ExceptionType which)
     } else if ((which == SyscallException) && (type == SC_Close)) {
         doClose();
         incrementPC();
+    } else if ((which == SyscallException) && (type == SC_Sbrk)) {
+        doSbrk();
+        incrementPC();
+    } else if ((which == SyscallException) && (type == SC_Mmap)) {
+        doMmap();
+        incrementPC();
+    } else if ((which == SyscallException) && (type == SC_Munmap)) {
+        doMunmap();
+        incrementPC();
+    } else if ((which == SyscallException) && (type == SC_SetPriority)) {
+        doSetPriority();
+        incrementPC();
+    } else if (which == PageFaultException) {
+        doPageFault(machine->ReadRegister(BadVAddrReg));
+    } else if (which == ReadOnlyException) {
+        doReadOnlyFault(machine->ReadRegister(BadVAddrReg));
     }else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(FALSE);
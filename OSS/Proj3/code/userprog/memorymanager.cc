@@ -1,12 +1,20 @@
 
-
 #include "memorymanager.h"
-#include "machine.h"
+#include "system.h"
+#include "addrspace.h"
 
 
-MemoryManager::MemoryManager() {
+MemoryManager::MemoryManager(int timeout) {
 
     bitmap = new BitMap(NumPhysPages);
+    refCount = new int[NumPhysPages];
+    owner = new AddrSpace*[NumPhysPages];
+    ownerPage = new unsigned int[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++)
+        owner[i] = NULL;
+    clockHand = 0;
+    admissionQueue = new List;
+    admissionTimeout = timeout;
 
 }
 
@@ -14,6 +22,10 @@ MemoryManager::MemoryManager() {
 MemoryManager::~MemoryManager() {
 
     delete bitmap;
+    delete [] refCount;
+    delete [] owner;
+    delete [] ownerPage;
+    delete admissionQueue;
 
 }
 
@@ -21,20 +33,107 @@ MemoryManager::~MemoryManager() {
 int MemoryManager::AllocatePage() {
     // printf("......", bitmap->Find());
 
-    return bitmap->Find();
+    int which = bitmap->Find();
+    if (which != -1)
+        refCount[which] = 1;
+    return which;
+
+}
+
+int MemoryManager::AllocateSuperPage() {
+
+    for (int first = 0; first + SuperPagePages <= NumPhysPages;
+            first += SuperPagePages) {
+        int i;
+        for (i = first; i < first + SuperPagePages; i++)
+            if (bitmap->Test(i))
+                break;
+        if (i < first + SuperPagePages)
+            continue;
+        for (i = first; i < first + SuperPagePages; i++) {
+            bitmap->Mark(i);
+            refCount[i] = 1;
+        }
+        return first;
+    }
+    return -1;
 
 }
 
 int MemoryManager::DeallocatePage(int which) {
 
     if(bitmap->Test(which) == false) return -1;
+    else if (--refCount[which] > 0) return 0;	// still shared
     else {
         bitmap->Clear(which);
+        owner[which] = NULL;
+        WakeWaiters();
         return 0;
     }
 
 }
 
+void MemoryManager::ShareFrame(int which) {
+
+    ASSERT(bitmap->Test(which));
+    refCount[which]++;
+
+}
+
+int MemoryManager::GetRefCount(int which) {
+
+    return bitmap->Test(which) ? refCount[which] : 0;
+
+}
+
+void MemoryManager::SetOwner(int which, AddrSpace *space, unsigned int vpn) {
+
+    owner[which] = space;
+    ownerPage[which] = vpn;
+
+}
+
+void MemoryManager::ForgetOwner(AddrSpace *space) {
+
+    for (int i = 0; i < NumPhysPages; i++)
+        if (owner[i] == space)
+            owner[i] = NULL;
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::EvictPage
+// 	Pick a frame with the clock algorithm and page out the page in
+//	it.  The hand skips frames that are shared, or whose page cannot
+//	be paged out, and gives every page whose use bit is set a second
+//	chance.
+//
+//	Returns the frame, now free, or -1 if no page could be paged out.
+//----------------------------------------------------------------------
+
+int MemoryManager::EvictPage() {
+
+    AddrSpace::SyncTLB();		// bring the use bits up to date
+    for (int step = 0; step < 2 * NumPhysPages; step++) {
+        int frame = clockHand;
+        clockHand = (clockHand + 1) % NumPhysPages;
+
+        AddrSpace *space = owner[frame];
+        if (space == NULL || refCount[frame] != 1
+                || !space->IsEvictable(ownerPage[frame], frame))
+            continue;
+        TranslationEntry *entry = &(space->GetPageTable()[ownerPage[frame]]);
+        if (entry->use) {
+            entry->use = FALSE;		// second chance
+            continue;
+        }
+        if (space->PageOut(ownerPage[frame]))
+            return frame;
+    }
+    return -1;
+
+}
+
 
 unsigned int MemoryManager::GetFreePageCount() {
 
@@ -42,4 +141,143 @@ unsigned int MemoryManager::GetFreePageCount() {
 
 }
 
+//----------------------------------------------------------------------
+// AdmissionTimeout
+// 	Interrupt handler for a WaitForPages that has waited long enough.
+//----------------------------------------------------------------------
+
+static void
+AdmissionTimeout(int arg)
+{
+    mm->TimeOut((AdmissionWaiter *) arg);
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::WaitForPages
+// 	Block the caller until "n" frames are free, so that a new
+//	process can be created instead of failing for lack of memory.
+//	Callers are let in first come, first served: nobody gets ahead
+//	of an earlier caller that is still waiting, even if it would fit.
+//
+//	Frames are not reserved, so a woken caller that finds them taken
+//	again goes back to the head of the queue.  If the manager was
+//	built with a timeout, a caller gives up after that many ticks,
+//	counted from when it first started waiting.
+//
+//	Returns TRUE once the frames are free, FALSE if the caller timed
+//	out or asked for more frames than the machine has.
+//----------------------------------------------------------------------
+
+bool MemoryManager::WaitForPages(unsigned int n) {
+
+    if (n > NumPhysPages)
+        return FALSE;
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    if (admissionQueue->IsEmpty() && n > GetFreePageCount())
+        pageMerger->Scan();		// merging may make enough room
+    if (admissionQueue->IsEmpty() && n <= GetFreePageCount()) {
+        (void) interrupt->SetLevel(oldLevel);
+        return TRUE;
+    }
+
+    AdmissionWaiter *waiter = new AdmissionWaiter;
+    waiter->thread = currentThread;
+    waiter->pages = n;
+    waiter->waiting = TRUE;
+    waiter->timedOut = FALSE;
+    waiter->timerPending = FALSE;
+    admissionQueue->Append((void *) waiter);
+    if (admissionTimeout > 0) {
+        waiter->timerPending = TRUE;
+        interrupt->Schedule(AdmissionTimeout, (int) waiter,
+                            admissionTimeout, TimerInt);
+    }
+    DEBUG('a', "Thread %s waiting for %d free pages\n",
+          currentThread->getName(), n);
+
+    for (;;) {
+        currentThread->Sleep();
+        if (waiter->timedOut || n <= GetFreePageCount())
+            break;
+        if (admissionTimeout > 0 && !waiter->timerPending) {
+            waiter->timedOut = TRUE;	// it fired after we were woken,
+            break;			// and would not fire again
+        }
+        waiter->waiting = TRUE;		// beaten to the frames
+        admissionQueue->Prepend((void *) waiter);
+    }
+
+    bool admitted = !waiter->timedOut;
+    if (waiter->timerPending)
+        waiter->thread = NULL;		// AdmissionTimeout frees it
+    else
+        delete waiter;
+    if (!admitted)
+        WakeWaiters();			// we may have held up the rest
+
+    (void) interrupt->SetLevel(oldLevel);
+    return admitted;
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::TimeOut
+// 	"waiter" has waited admissionTimeout ticks.  If it is still on
+//	the queue, take it off and wake it up empty handed.
+//----------------------------------------------------------------------
 
+void MemoryManager::TimeOut(AdmissionWaiter *waiter) {
+
+    waiter->timerPending = FALSE;
+    if (waiter->thread == NULL) {	// it left a while ago
+        delete waiter;
+        return;
+    }
+    if (!waiter->waiting)		// already woken with its frames
+        return;
+
+    // the List has no way to remove from the middle, so rebuild it
+    List *rest = new List;
+    while (!admissionQueue->IsEmpty()) {
+        AdmissionWaiter *w = (AdmissionWaiter *) admissionQueue->Remove();
+        if (w != waiter)
+            rest->Append((void *) w);
+    }
+    delete admissionQueue;
+    admissionQueue = rest;
+
+    DEBUG('a', "Thread %s gave up waiting for %d free pages\n",
+          waiter->thread->getName(), waiter->pages);
+    waiter->waiting = FALSE;
+    waiter->timedOut = TRUE;
+    scheduler->ReadyToRun(waiter->thread);
+
+}
+
+//----------------------------------------------------------------------
+// MemoryManager::WakeWaiters
+// 	Wake up waiters from the head of the queue for as long as the
+//	free frames cover all of them.  Stops at the first one that does
+//	not fit, to keep the order fair.
+//----------------------------------------------------------------------
+
+void MemoryManager::WakeWaiters() {
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    unsigned int available = GetFreePageCount();
+
+    while (!admissionQueue->IsEmpty()) {
+        AdmissionWaiter *waiter = (AdmissionWaiter *) admissionQueue->Remove();
+        if (waiter->pages > available) {
+            admissionQueue->Prepend((void *) waiter);
+            break;
+        }
+        available -= waiter->pages;
+        waiter->waiting = FALSE;
+        scheduler->ReadyToRun(waiter->thread);
+    }
+
+    (void) interrupt->SetLevel(oldLevel);
+
+}
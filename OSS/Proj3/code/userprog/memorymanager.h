@@ -2,22 +2,64 @@
 #define MEMORY_H
 
 #include "bitmap.h"
+#include "list.h"
+
+class Thread;
+class AddrSpace;
+
+// A process creation blocked in MemoryManager::WaitForPages until
+// enough frames are free to hold it.
+
+class AdmissionWaiter {
+    public:
+        Thread *thread;		// who is waiting; NULL once it has left
+				// but its timeout is still pending
+        unsigned int pages;	// frames it needs
+        bool waiting;		// still on the admission queue
+        bool timedOut;		// gave up before the frames came free
+        bool timerPending;	// its timeout interrupt has not fired yet
+};
 
 class MemoryManager {
 
     public:
-        MemoryManager();
+        MemoryManager(int timeout = 0);	// timeout in ticks for
+					// WaitForPages, 0 to wait forever
         ~MemoryManager();
 
         int AllocatePage();
-        int DeallocatePage(int which);
+        int AllocateSuperPage();	// SuperPagePages aligned frames in
+					// a row; returns the first, or -1
+        int DeallocatePage(int which);	// drop one reference to a frame
         unsigned int GetFreePageCount();
 
+        void ShareFrame(int which);	// one more page maps "which"
+        int GetRefCount(int which);
+
+        void SetOwner(int which, AddrSpace *space, unsigned int vpn);
+        void ForgetOwner(AddrSpace *space); // "space" is going away
+        int EvictPage();		// free a frame by paging one out;
+					// call with mmLock held
+
+        bool WaitForPages(unsigned int n); // block until n frames are
+					// free; FALSE on timeout
+        void TimeOut(AdmissionWaiter *waiter); // called by the timeout
+					// interrupt handler
+
     private:
         BitMap *bitmap;
+        int *refCount;			// pages mapping each frame
+        AddrSpace **owner;		// core map: which page each frame
+        unsigned int *ownerPage;	// holds (one of them, if shared)
+        int clockHand;			// next frame EvictPage looks at
+        List *admissionQueue;		// AdmissionWaiters, first come
+					// first served
+        int admissionTimeout;
+
+        void WakeWaiters();		// let in whoever fits now
 
 };
 
 
 
-#endif // MEMORY_H
\ No newline at end of file
+#endif // MEMORY_H
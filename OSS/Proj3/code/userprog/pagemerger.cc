@@ -0,0 +1,160 @@
+// pagemerger.cc
+//	Routines to merge identical pages across processes.
+//
+//	A scan hashes every mergeable resident page, and for each hash
+//	remembers the first frame seen with it.  A later page whose frame
+//	holds the same bytes is pointed at that frame instead, both pages
+//	are write-protected, and its own frame is released.  Reference
+//	counts in the MemoryManager keep a frame allocated for as long as
+//	some page still maps it.
+//
+//	Scans run with interrupts off, so no process can touch its pages
+//	half way through.  They are started when the CPU would otherwise
+//	idle, and when memory runs out.
+
+#include "copyright.h"
+#include "system.h"
+#include "pagemerger.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// HashFrame
+// 	FNV-1a hash of the contents of a physical page.
+//----------------------------------------------------------------------
+
+static unsigned int
+HashFrame(int frame)
+{
+    unsigned char *p = (unsigned char *) &(machine->mainMemory[frame * PageSize]);
+    unsigned int hash = 2166136261u;
+
+    for (int i = 0; i < PageSize; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::PageMerger
+// 	Start out with no address spaces to scan.
+//----------------------------------------------------------------------
+
+PageMerger::PageMerger()
+{
+    for (int i = 0; i < MaxMergeSpaces; i++)
+        spaces[i] = NULL;
+    lastScan = 0;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::AddSpace / RemoveSpace
+// 	Keep track of the live address spaces.  A space that does not fit
+//	in the table is simply never scanned.
+//----------------------------------------------------------------------
+
+void
+PageMerger::AddSpace(AddrSpace *space)
+{
+    for (int i = 0; i < MaxMergeSpaces; i++)
+        if (spaces[i] == NULL) {
+            spaces[i] = space;
+            return;
+        }
+}
+
+void
+PageMerger::RemoveSpace(AddrSpace *space)
+{
+    for (int i = 0; i < MaxMergeSpaces; i++)
+        if (spaces[i] == space)
+            spaces[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::IdleScan
+// 	Called when there is no thread to run.  Scanning takes no
+//	simulated time, but there is no point doing it more often than
+//	every MergeScanInterval ticks.
+//----------------------------------------------------------------------
+
+void
+PageMerger::IdleScan()
+{
+    if (stats->totalTicks - lastScan < MergeScanInterval)
+        return;
+    Scan();
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Scan
+// 	Go over every resident page of every address space once, and
+//	merge each frame into the first frame seen with the same contents.
+//----------------------------------------------------------------------
+
+void
+PageMerger::Scan()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int merged = 0;
+
+    lastScan = stats->totalTicks;
+    for (int i = 0; i < 2 * NumPhysPages; i++)
+        table[i].frame = -1;
+
+    for (int s = 0; s < MaxMergeSpaces; s++) {
+        AddrSpace *space = spaces[s];
+        if (space == NULL)
+            continue;
+        TranslationEntry *pageTable = space->GetPageTable();
+        for (unsigned int vpn = 0; vpn < space->GetNumPages(); vpn++) {
+            if (!space->IsMergeable(vpn))
+                continue;
+            if (Merge(space, vpn, HashFrame(pageTable[vpn].physicalPage)))
+                merged++;
+        }
+    }
+
+    DEBUG('a', "Page merger scan: merged %d pages, %d frames free\n",
+          merged, mm->GetFreePageCount());
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Merge
+// 	Look up the frame of page "vpn" of "space" by its hash "hash".
+//	If an earlier frame holds the same bytes, share that one instead;
+//	otherwise remember this frame for the pages that follow.
+//
+//	Returns TRUE if the page was merged.
+//----------------------------------------------------------------------
+
+bool
+PageMerger::Merge(AddrSpace *space, unsigned int vpn, unsigned int hash)
+{
+    int frame = space->GetPageTable()[vpn].physicalPage;
+    int slot = hash % (2 * NumPhysPages);
+
+    for (; table[slot].frame != -1; slot = (slot + 1) % (2 * NumPhysPages)) {
+        Candidate *c = &table[slot];
+        if (c->hash != hash)
+            continue;
+        if (c->frame == frame)		// merged already
+            return FALSE;
+        if (memcmp(&(machine->mainMemory[c->frame * PageSize]),
+                   &(machine->mainMemory[frame * PageSize]), PageSize) != 0)
+            continue;			// same hash, different bytes
+
+        c->space->SharePage(c->vpn, c->frame);
+        space->SharePage(vpn, c->frame);
+        stats->numPagesMerged++;
+        return TRUE;
+    }
+
+    // there are at most NumPhysPages frames, so the table never fills
+    table[slot].hash = hash;
+    table[slot].frame = frame;
+    table[slot].space = space;
+    table[slot].vpn = vpn;
+    return FALSE;
+}
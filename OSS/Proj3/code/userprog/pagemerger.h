@@ -0,0 +1,51 @@
+// pagemerger.h
+//	Data structures for merging identical pages across processes.
+//
+//	Processes running the same program end up with many frames
+//	holding the same bytes: zeroed bss and stack pages, unchanged
+//	data pages, and whatever Fork copied.  The page merger finds such
+//	frames by hashing their contents and maps all of their pages onto
+//	one read-only frame, shared copy-on-write, so that more processes
+//	fit in NumPhysPages.  A write to a shared page traps with a
+//	ReadOnlyException and gets a private copy back (see
+//	AddrSpace::UnsharePage).
+
+#ifndef PAGEMERGER_H
+#define PAGEMERGER_H
+
+#include "copyright.h"
+#include "machine.h"
+
+class AddrSpace;
+
+#define MaxMergeSpaces		16	// address spaces scanned at once
+#define MergeScanInterval	1000	// least ticks between idle scans
+
+class PageMerger {
+  public:
+    PageMerger();
+
+    void AddSpace(AddrSpace *space);	// start scanning "space"
+    void RemoveSpace(AddrSpace *space);	// "space" is going away
+
+    void Scan();			// merge identical frames now
+    void IdleScan();			// called when the CPU is idle
+
+  private:
+    AddrSpace *spaces[MaxMergeSpaces];
+    int lastScan;			// totalTicks at the last scan
+
+    // one frame seen during a scan, and one page that maps it
+    class Candidate {
+      public:
+        unsigned int hash;
+        int frame;			// -1 if this slot is empty
+        AddrSpace *space;
+        unsigned int vpn;
+    };
+    Candidate table[2 * NumPhysPages];	// open hashing on "hash"
+
+    bool Merge(AddrSpace *space, unsigned int vpn, unsigned int hash);
+};
+
+#endif // PAGEMERGER_H
@@ -1,11 +1,13 @@
 #include "pcb.h"
+#include "synch.h"
 
 
 PCB::PCB(int id) {
 
     pid = id;
     parent = NULL;
-    children = new List();
+    children = new DList<PCB, &PCB::siblingLink>;
+    childExited = new Semaphore("childExited", 0);
     thread = NULL;
     exitStatus = -9999;
     for (int i = 0; i < MAX_OPEN_FILES; i++) {
@@ -14,11 +16,10 @@ PCB::PCB(int id) {
 
 }
 
-
-
 PCB::~PCB() {
 
     delete children;
+    delete childExited;
 
 }
 
@@ -39,13 +40,47 @@ int PCB::RemoveChild(PCB* pcb){
 }
 
 
+// Compares pointers only: "pcb" may have been deallocated already
+bool PCB::HasChild(PCB* pcb) {
+    for (PCB* child = children->First(); child != NULL; child = children->Next(child)) {
+        if (child == pcb) return true;
+    }
+    return false;
+}
+
+
+bool PCB::HasChildren() {
+    return !children->IsEmpty();
+}
+
+
+PCB* PCB::ExitedChild() {
+    for (PCB* child = children->First(); child != NULL; child = children->Next(child)) {
+        if (child->HasExited()) return child;
+    }
+    return NULL;
+}
+
+
+// Join sleeps here rather than polling with Yield.  The semaphore
+// counts exits nobody waited for yet, so the caller must check again
+// for the child it wants each time this returns.
+void PCB::WaitForChild() {
+    childExited->P();
+}
+
+
+void PCB::ChildExited() {
+    childExited->V();
+}
+
+
 bool PCB::HasExited() {
     return exitStatus == -9999 ? false : true;
 }
 
 
-void decspn(int arg) {
-    PCB* pcb = (PCB*)arg;
+void decspn(PCB* pcb) {
     if (pcb->HasExited()) pcbManager->DeallocatePCB(pcb);
     else pcb->parent = NULL;
 }
@@ -53,7 +88,10 @@ void decspn(int arg) {
 
 void PCB::DeleteExitedChildrenSetParentNull() {
     if(!children->IsEmpty()){
-        children->Mapcar(decspn);
+        // take each child off the list first, it may be deallocated
+        PCB* child;
+        while ((child = children->Remove()) != NULL)
+            decspn(child);
     }
     else{
         parent = NULL;
@@ -90,3 +128,13 @@ bool PCB::CloseOpenFile(int fd) {
     openFileTable[fd] = NULL;
     return true;
 }
+
+// Free the descriptor without closing the file; the caller now owns it
+OpenFile* PCB::DetachOpenFile(int fd) {
+    OpenFile* file = GetOpenFile(fd);
+    if (fd < 2 || file == NULL) {
+        return NULL;
+    }
+    openFileTable[fd] = NULL;
+    return file;
+}
@@ -2,10 +2,12 @@
 #define PCB_H
 #define MAX_OPEN_FILES 64
 
-#include "list.h"
+#include "dlist.h"
+#include "objcache.h"
 #include "pcbmanager.h"
 
 class Thread;
+class Semaphore;
 class PCBManager;
 extern PCBManager* pcbManager;
 
@@ -14,6 +16,7 @@ class PCB {
     public:
         PCB(int id);
         ~PCB();
+        CACHED_OBJECTS(PCB)
         int pid;
         PCB* parent;
         Thread* thread;
@@ -21,15 +24,23 @@ class PCB {
         OpenFile* openFileTable[MAX_OPEN_FILES];
         void AddChild(PCB* pcb);
         int RemoveChild(PCB* pcb);
+        bool HasChild(PCB* pcb);
+        bool HasChildren();
+        PCB* ExitedChild();         // one that has exited, if any
+        void WaitForChild();        // sleep until a child exits
+        void ChildExited();         // wake the process waiting in Join
         bool HasExited();
         void DeleteExitedChildrenSetParentNull();
         int AddOpenFile(OpenFile* openFile);
         OpenFile* GetOpenFile(int fd);
         bool CloseOpenFile(int fd);
+        OpenFile* DetachOpenFile(int fd);
+        DListLink<PCB> siblingLink;	// on our parent's list of children
 
 
     private:
-        List* children;
+        DList<PCB, &PCB::siblingLink>* children;
+        Semaphore* childExited;     // signalled each time a child exits
         
 
 };
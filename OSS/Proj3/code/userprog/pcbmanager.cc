@@ -1,12 +1,13 @@
 // pcbmanager.cc
 
 #include "pcbmanager.h"
+#include "synch.h"
 
 PCBManager::PCBManager(int initialMaxProcesses) {
     this->maxProcesses = initialMaxProcesses + 1; // Include PID 0
     bitmap = new BitMap(this->maxProcesses);
     pcbs = new PCB*[this->maxProcesses];
-    pcbManagerLock = new Lock("PCBManagerLock");
+    pcbManagerLock = new RWLock("PCBManagerLock");
 
     // Mark PID 0 as used to reserve it
     bitmap->Mark(0);
@@ -23,35 +24,37 @@ PCBManager::~PCBManager() {
 }
 
 PCB* PCBManager::AllocatePCB() {
-    pcbManagerLock->Acquire();
+    pcbManagerLock->AcquireWrite();
     int pid = bitmap->Find();
     if (pid == -1) {
-        pcbManagerLock->Release();
+        pcbManagerLock->ReleaseWrite();
         return NULL; // No available PID
     }
-    pcbs[pid] = new PCB(pid);
-    bitmap->Mark(pid);
-    pcbManagerLock->Release();
-    return pcbs[pid];
+    PCB* pcb = pcbs[pid] = new PCB(pid);
+    pcbManagerLock->ReleaseWrite();
+    return pcb;
 }
 
 int PCBManager::DeallocatePCB(PCB* pcb) {
-    pcbManagerLock->Acquire();
+    pcbManagerLock->AcquireWrite();
     int pid = pcb->pid;
     if (pid > 0 && pid < maxProcesses) {
         bitmap->Clear(pid); // Release the PID
         delete pcbs[pid];
         pcbs[pid] = NULL;
     }
-    pcbManagerLock->Release();
+    pcbManagerLock->ReleaseWrite();
     return 0;
 }
 
 PCB* PCBManager::GetPCB(int pid) {
+    PCB* pcb = NULL;
     if (pid > 0 && pid < maxProcesses) {
-    return pcbs[pid];
+        pcbManagerLock->AcquireRead();
+        pcb = pcbs[pid];
+        pcbManagerLock->ReleaseRead();
     }
-    return NULL;
+    return pcb;
 }
 
 int PCBManager::GetMaxProcesses() {
@@ -59,9 +62,13 @@ int PCBManager::GetMaxProcesses() {
 }
 
 // pcbmanager.cc
+// Only looks: BitMap::Find would take the pid, and it was never given back
 int PCBManager::GetNextFreePid() {
-    pcbManagerLock->Acquire();
-    int pid = bitmap->Find();
-    pcbManagerLock->Release();
+    pcbManagerLock->AcquireRead();
+    int pid = -1;
+    for (int i = 1; i < maxProcesses && pid == -1; i++) {
+        if (!bitmap->Test(i)) pid = i;
+    }
+    pcbManagerLock->ReleaseRead();
     return (pid == -1) ? maxProcesses + 1 : pid; // If no PID available, return an out-of-range value
 }
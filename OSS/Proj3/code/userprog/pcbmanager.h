@@ -3,10 +3,9 @@
 
 #include "bitmap.h"
 #include "pcb.h"
-#include "synch.h"
 
 class PCB;
-class Lock;
+class RWLock;
 
 class PCBManager {
 
@@ -24,8 +23,9 @@ class PCBManager {
     private:
         BitMap* bitmap;
         PCB** pcbs;
-        // Need a lock here
-        Lock* pcbManagerLock;
+        // Looking up a PCB, which every Join and Kill does, only
+        // needs the lock in shared mode
+        RWLock* pcbManagerLock;
         int maxProcesses; 
 
 };
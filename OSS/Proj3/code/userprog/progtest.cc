@@ -30,12 +30,11 @@ StartProcess(char *filename)
 	printf("Unable to open file %s\n", filename);
 	return;
     }
-    space = new AddrSpace(executable);    
+    space = new AddrSpace(executable);	// keeps the file open, to
+					// page the program in from
     // printf("mm->GetFreePageCount() = %d\n", mm->GetFreePageCount());
     currentThread->space = space;
 
-    delete executable;			// close file
-
     space->InitRegisters();		// set the initial register values
     space->RestoreState();		// load page table register
 
@@ -0,0 +1,263 @@
+// swapcache.cc
+//	Routines to compress evicted pages into memory, and to spill
+//	them to the swap file when memory is not enough.
+//
+//	Pages are compressed with a small LZ77 scheme: a flag byte tells,
+//	for each of the next eight items, whether it is a literal byte or
+//	a back reference of two bytes (distance - 1, length - MinMatch)
+//	into the part of the page already produced.  A zeroed page, the
+//	most common kind, shrinks to a handful of bytes.
+//
+//	None of this takes simulated time; only a spill to the swap file
+//	does, as disk I/O.
+
+#include "copyright.h"
+#include "system.h"
+#include "swapcache.h"
+
+#define MinMatch	3		// shortest back reference
+#define MaxMatch	(MinMatch + 255) // longest one
+
+//----------------------------------------------------------------------
+// Compress
+// 	Compress one page from "in" into "out", which must have room for
+//	PageSize + PageSize/8 + 1 bytes.  Returns the compressed length.
+//----------------------------------------------------------------------
+
+static int
+Compress(char *in, char *out)
+{
+    int inPos = 0, outPos = 0;
+
+    while (inPos < PageSize) {
+        int flagPos = outPos++;
+        out[flagPos] = 0;
+        for (int item = 0; item < 8 && inPos < PageSize; item++) {
+            int bestLength = 0, bestDistance = 0;
+            for (int from = max(0, inPos - 256); from < inPos; from++) {
+                int length = 0;
+                while (inPos + length < PageSize && length < MaxMatch
+                        && in[from + length] == in[inPos + length])
+                    length++;
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = inPos - from;
+                }
+            }
+            if (bestLength >= MinMatch) {
+                out[flagPos] |= 1 << item;
+                out[outPos++] = (char) (bestDistance - 1);
+                out[outPos++] = (char) (bestLength - MinMatch);
+                inPos += bestLength;
+            } else
+                out[outPos++] = in[inPos++];
+        }
+    }
+    return outPos;
+}
+
+//----------------------------------------------------------------------
+// Decompress
+// 	Undo Compress: expand "length" bytes of "in" into a page at "out".
+//----------------------------------------------------------------------
+
+static void
+Decompress(char *in, int length, char *out)
+{
+    int inPos = 0, outPos = 0;
+
+    while (inPos < length) {
+        int flags = (unsigned char) in[inPos++];
+        for (int item = 0; item < 8 && inPos < length; item++) {
+            if (flags & (1 << item)) {
+                int distance = (unsigned char) in[inPos++] + 1;
+                int count = (unsigned char) in[inPos++] + MinMatch;
+                for (int i = 0; i < count; i++, outPos++)
+                    out[outPos] = out[outPos - distance];
+            } else
+                out[outPos++] = in[inPos++];
+        }
+    }
+    ASSERT(outPos == PageSize);
+}
+
+//----------------------------------------------------------------------
+// SwapCache::SwapCache, SwapCache::~SwapCache
+// 	Start out with an empty arena.  The swap file is only created if
+//	it is ever needed; under FILESYS_STUB it is a UNIX file, so it is
+//	removed again at halt.
+//----------------------------------------------------------------------
+
+SwapCache::SwapCache()
+{
+    chunkMap = new BitMap(SwapArenaSize / SwapChunkSize);
+    diskMap = new BitMap(SwapDiskPages);
+    swapFile = NULL;
+    for (int i = 0; i < MaxSwapEntries; i++)
+        entries[i].inUse = FALSE;
+}
+
+SwapCache::~SwapCache()
+{
+    delete chunkMap;
+    delete diskMap;
+    if (swapFile != NULL) {
+        delete swapFile;
+#ifdef FILESYS_STUB
+        fileSystem->Remove("SWAP");	// don't leave it behind in the
+#endif					// UNIX directory we ran in
+    }
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Store
+// 	Save the page at "page".  It goes into the arena if it compresses
+//	and fits there, and to the swap file otherwise.
+//
+//	Returns a handle for Load, or -1 if neither has room.
+//----------------------------------------------------------------------
+
+int
+SwapCache::Store(char *page)
+{
+    char buffer[PageSize + PageSize / 8 + 1];
+    int handle;
+
+    for (handle = 0; handle < MaxSwapEntries; handle++)
+        if (!entries[handle].inUse)
+            break;
+    if (handle == MaxSwapEntries)
+        return -1;
+    Entry *e = &entries[handle];
+
+    int length = Compress(page, buffer);
+    int chunks = divRoundUp(length, SwapChunkSize);
+    int first = (length < PageSize) ? AllocateChunks(chunks) : -1;
+
+    if (first != -1) {
+        bcopy(buffer, &arena[first * SwapChunkSize], length);
+        e->onDisk = FALSE;
+        e->firstChunk = first;
+        e->numChunks = chunks;
+        e->length = length;
+        stats->numSwapCompressed++;
+        stats->numSwapRawBytes += PageSize;
+        stats->numSwapCompressedBytes += length;
+    } else {
+        e->diskPage = StoreOnDisk(page);
+        if (e->diskPage == -1)
+            return -1;
+        e->onDisk = TRUE;
+    }
+    e->inUse = TRUE;
+    stats->numSwapOuts++;
+    DEBUG('a', "Swapped out a page as handle %d, %d bytes %s\n", handle,
+          e->onDisk ? PageSize : length, e->onDisk ? "on disk" : "compressed");
+    return handle;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Load
+// 	Bring the page saved as "handle" back into "page", and free it.
+//----------------------------------------------------------------------
+
+void
+SwapCache::Load(int handle, char *page)
+{
+    Entry *e = &entries[handle];
+
+    ASSERT(e->inUse);
+    if (e->onDisk) {
+        swapFile->ReadAt(page, PageSize, e->diskPage * PageSize);
+        stats->numSwapDiskReads++;
+    } else {
+        Decompress(&arena[e->firstChunk * SwapChunkSize], e->length, page);
+        stats->numSwapHits++;
+    }
+    Free(handle);
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Duplicate
+// 	Save a second copy of the page saved as "handle", for a child
+//	that gets a copy of the address space.  Returns -1 if there is no
+//	room for it.
+//----------------------------------------------------------------------
+
+int
+SwapCache::Duplicate(int handle)
+{
+    Entry *e = &entries[handle];
+    char page[PageSize];
+
+    ASSERT(e->inUse);
+    if (e->onDisk)
+        swapFile->ReadAt(page, PageSize, e->diskPage * PageSize);
+    else
+        Decompress(&arena[e->firstChunk * SwapChunkSize], e->length, page);
+    return Store(page);
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Free
+// 	Release the space held by "handle".
+//----------------------------------------------------------------------
+
+void
+SwapCache::Free(int handle)
+{
+    Entry *e = &entries[handle];
+
+    ASSERT(e->inUse);
+    if (e->onDisk)
+        diskMap->Clear(e->diskPage);
+    else
+        for (int i = 0; i < e->numChunks; i++)
+            chunkMap->Clear(e->firstChunk + i);
+    e->inUse = FALSE;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::AllocateChunks
+// 	Find "n" free chunks in a row in the arena, and mark them used.
+//	Returns the first one, or -1 if there is no such run.
+//----------------------------------------------------------------------
+
+int
+SwapCache::AllocateChunks(int n)
+{
+    int run = 0;
+
+    for (int i = 0; i < SwapArenaSize / SwapChunkSize; i++) {
+        run = chunkMap->Test(i) ? 0 : run + 1;
+        if (run == n) {
+            for (int j = i - n + 1; j <= i; j++)
+                chunkMap->Mark(j);
+            return i - n + 1;
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::StoreOnDisk
+// 	Write an uncompressed page to the swap file, creating the file
+//	the first time.  Returns its page in the file, or -1 if full.
+//----------------------------------------------------------------------
+
+int
+SwapCache::StoreOnDisk(char *page)
+{
+    if (swapFile == NULL) {
+        if (!fileSystem->Create("SWAP", SwapDiskPages * PageSize))
+            return -1;
+        swapFile = fileSystem->Open("SWAP");
+        if (swapFile == NULL)
+            return -1;
+    }
+
+    int diskPage = diskMap->Find();
+    if (diskPage != -1)
+        swapFile->WriteAt(page, PageSize, diskPage * PageSize);
+    return diskPage;
+}
@@ -0,0 +1,58 @@
+// swapcache.h
+//	Data structures for keeping evicted pages.
+//
+//	A page picked for eviction is first compressed into a fixed-size
+//	kernel arena, so that faulting it back in costs a decompression
+//	instead of a disk read.  Only pages that do not compress, or that
+//	do not fit in the arena any more, are written to the swap file.
+//
+//	Every stored page is named by a handle, which the address space
+//	keeps in place of the frame number while the page is out.
+
+#ifndef SWAPCACHE_H
+#define SWAPCACHE_H
+
+#include "copyright.h"
+#include "machine.h"
+#include "bitmap.h"
+#include "openfile.h"
+
+#define SwapChunkSize		16	// arena allocation unit, in bytes
+#define SwapArenaSize		(32 * PageSize)	// compressed page space
+#define SwapDiskPages		24	// pages in the swap file
+#define MaxSwapEntries		(NumPhysPages * 4) // pages out at once
+
+class SwapCache {
+  public:
+    SwapCache();
+    ~SwapCache();
+
+    int Store(char *page);		// save a page, return its handle,
+					// or -1 if there is no room left
+    void Load(int handle, char *page);	// get a page back, and free it
+    int Duplicate(int handle);		// a second copy, for Fork
+    void Free(int handle);		// the page is not needed any more
+
+  private:
+    // where one stored page is
+    class Entry {
+      public:
+        bool inUse;
+        bool onDisk;			// in the swap file, not the arena
+        int firstChunk;			// arena: first chunk and the
+        int numChunks;			// number of chunks taken
+        int length;			// arena: compressed length
+        int diskPage;			// swap file: page number
+    };
+
+    char arena[SwapArenaSize];
+    BitMap *chunkMap;			// arena chunks in use
+    Entry entries[MaxSwapEntries];
+    OpenFile *swapFile;			// opened on the first spill
+    BitMap *diskMap;			// swap file pages in use
+
+    int AllocateChunks(int n);		// first fit, -1 if none
+    int StoreOnDisk(char *page);	// returns the swap file page
+};
+
+#endif // SWAPCACHE_H
@@ -30,6 +30,11 @@
 #define SC_Fork		9
 #define SC_Yield	10
 #define SC_Kill     11
+#define SC_Mmap     12
+#define SC_Munmap   13
+#define SC_Sbrk     14
+#define SC_SetPriority 15
+#define SC_JoinAny  16
 
 #ifndef IN_ASM
 
@@ -65,6 +70,13 @@ SpaceId Exec(char *name);
  */
 int Join(SpaceId id);
 
+/* Only return once one of this process's children has finished.
+ * Return its address space identifier, and store its exit status
+ * in "*status" unless "status" is 0.  Return -1 if there are no
+ * children left to wait for.
+ */
+SpaceId JoinAny(int *status);
+
 
 /* File system operations: Create, Open, Read, Write, Close
  * These functions are patterned after UNIX -- files represent
@@ -129,6 +141,37 @@ void Yield();
  */
 int Kill(SpaceId id);
 
+/* Set the scheduling priority of the calling process, from 0 (lowest)
+ * to 31 (highest); 16 is the default.  A process forked later starts
+ * at its parent's priority.  Return the old priority, or -1 if
+ * "priority" is out of range.
+ */
+int SetPriority(int priority);
+
+
+/* Grow the heap by "increment" bytes (shrink it, if negative) and
+ * return the old end of the heap, or -1 if it cannot grow that far.
+ * New heap memory reads as zero.  Used by malloc in test/malloc.c.
+ */
+int Sbrk(int increment);
+
+
+/* Memory-mapped files: Mmap and Munmap */
+
+/* Map the first "length" bytes of the open file "id" (the whole file if
+ * "length" is 0 or more than its size) into the address space, and
+ * return the address of the mapping, or -1 on error.  Pages are read
+ * in from the file when first touched; modified pages are written back
+ * by Munmap, or at Exit.  A mapping never makes the file grow.
+ * The file may be closed while it is mapped.
+ */
+int Mmap(OpenFileId id, int length);
+
+/* Unmap the region returned by Mmap at "addr", writing back modified
+ * pages.  Return 0 if successful; -1 if not
+ */
+int Munmap(int addr);
+
 
 #endif /* IN_ASM */
 